@@ -6,41 +6,86 @@
 C_SRCS += \
 ../src/Source_files/HW_delay.c \
 ../src/Source_files/SI7021.c \
+../src/Source_files/adapt.c \
 ../src/Source_files/app.c \
+../src/Source_files/batch.c \
+../src/Source_files/bench.c \
 ../src/Source_files/ble.c \
+../src/Source_files/change.c \
 ../src/Source_files/cmu.c \
+../src/Source_files/cobs.c \
+../src/Source_files/codec.c \
+../src/Source_files/command.c \
+../src/Source_files/config.c \
+../src/Source_files/filter.c \
+../src/Source_files/flash_log.c \
+../src/Source_files/format.c \
+../src/Source_files/gpcrc.c \
 ../src/Source_files/gpio.c \
 ../src/Source_files/i2c.c \
 ../src/Source_files/letimer.c \
 ../src/Source_files/leuart.c \
 ../src/Source_files/scheduler.c \
-../src/Source_files/sleep_routines.c 
+../src/Source_files/sleep_routines.c \
+../src/Source_files/spsc_ring.c \
+../src/Source_files/stats.c \
+../src/Source_files/usart.c 
 
 OBJS += \
 ./src/Source_files/HW_delay.o \
 ./src/Source_files/SI7021.o \
+./src/Source_files/adapt.o \
 ./src/Source_files/app.o \
+./src/Source_files/batch.o \
+./src/Source_files/bench.o \
 ./src/Source_files/ble.o \
+./src/Source_files/change.o \
 ./src/Source_files/cmu.o \
+./src/Source_files/cobs.o \
+./src/Source_files/codec.o \
+./src/Source_files/command.o \
+./src/Source_files/config.o \
+./src/Source_files/filter.o \
+./src/Source_files/flash_log.o \
+./src/Source_files/format.o \
+./src/Source_files/gpcrc.o \
 ./src/Source_files/gpio.o \
 ./src/Source_files/i2c.o \
 ./src/Source_files/letimer.o \
 ./src/Source_files/leuart.o \
 ./src/Source_files/scheduler.o \
-./src/Source_files/sleep_routines.o 
+./src/Source_files/sleep_routines.o \
+./src/Source_files/spsc_ring.o \
+./src/Source_files/stats.o \
+./src/Source_files/usart.o 
 
 C_DEPS += \
 ./src/Source_files/HW_delay.d \
 ./src/Source_files/SI7021.d \
+./src/Source_files/adapt.d \
 ./src/Source_files/app.d \
+./src/Source_files/batch.d \
+./src/Source_files/bench.d \
 ./src/Source_files/ble.d \
+./src/Source_files/change.d \
 ./src/Source_files/cmu.d \
+./src/Source_files/cobs.d \
+./src/Source_files/codec.d \
+./src/Source_files/command.d \
+./src/Source_files/config.d \
+./src/Source_files/filter.d \
+./src/Source_files/flash_log.d \
+./src/Source_files/format.d \
+./src/Source_files/gpcrc.d \
 ./src/Source_files/gpio.d \
 ./src/Source_files/i2c.d \
 ./src/Source_files/letimer.d \
 ./src/Source_files/leuart.d \
 ./src/Source_files/scheduler.d \
-./src/Source_files/sleep_routines.d 
+./src/Source_files/sleep_routines.d \
+./src/Source_files/spsc_ring.d \
+./src/Source_files/stats.d \
+./src/Source_files/usart.d 
 
 
 # Each subdirectory must supply rules for building sources it contributes
@@ -58,6 +103,13 @@ src/Source_files/SI7021.o: ../src/Source_files/SI7021.c
 	@echo 'Finished building: $<'
 	@echo ' '
 
+src/Source_files/adapt.o: ../src/Source_files/adapt.c
+	@echo 'Building file: $<'
+	@echo 'Invoking: GNU ARM C Compiler'
+	arm-none-eabi-gcc -g3 -gdwarf-2 -mcpu=cortex-m4 -mthumb -std=c99 '-DRETARGET_VCOM=1' '-DDEBUG_EFM=1' '-DEFM32PG12B500F1024GL125=1' -I"C:\Users\thwaitester\Desktop\ECEN3360_DDL\MyLab\JT_Course_Project\src\Header_files" -I"C:\Users\thwaitester\Desktop\ECEN3360_DDL\MyLab\JT_Course_Project\src\Source_files" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//platform/emlib/inc" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//platform/CMSIS/Include" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//hardware/kit/SLSTK3402A_EFM32PG12/config" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//hardware/kit/common/bsp" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//platform/Device/SiliconLabs/EFM32PG12B/Include" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//hardware/kit/common/drivers" -O2 -Wall -c -fmessage-length=0 -ffunction-sections -fdata-sections -mfpu=fpv4-sp-d16 -mfloat-abi=softfp -MMD -MP -MF"src/Source_files/adapt.d" -MT"src/Source_files/adapt.o" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
 src/Source_files/app.o: ../src/Source_files/app.c
 	@echo 'Building file: $<'
 	@echo 'Invoking: GNU ARM C Compiler'
@@ -65,6 +117,20 @@ src/Source_files/app.o: ../src/Source_files/app.c
 	@echo 'Finished building: $<'
 	@echo ' '
 
+src/Source_files/batch.o: ../src/Source_files/batch.c
+	@echo 'Building file: $<'
+	@echo 'Invoking: GNU ARM C Compiler'
+	arm-none-eabi-gcc -g3 -gdwarf-2 -mcpu=cortex-m4 -mthumb -std=c99 '-DRETARGET_VCOM=1' '-DDEBUG_EFM=1' '-DEFM32PG12B500F1024GL125=1' -I"C:\Users\thwaitester\Desktop\ECEN3360_DDL\MyLab\JT_Course_Project\src\Header_files" -I"C:\Users\thwaitester\Desktop\ECEN3360_DDL\MyLab\JT_Course_Project\src\Source_files" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//platform/emlib/inc" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//platform/CMSIS/Include" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//hardware/kit/SLSTK3402A_EFM32PG12/config" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//hardware/kit/common/bsp" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//platform/Device/SiliconLabs/EFM32PG12B/Include" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//hardware/kit/common/drivers" -O2 -Wall -c -fmessage-length=0 -ffunction-sections -fdata-sections -mfpu=fpv4-sp-d16 -mfloat-abi=softfp -MMD -MP -MF"src/Source_files/batch.d" -MT"src/Source_files/batch.o" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+src/Source_files/bench.o: ../src/Source_files/bench.c
+	@echo 'Building file: $<'
+	@echo 'Invoking: GNU ARM C Compiler'
+	arm-none-eabi-gcc -g3 -gdwarf-2 -mcpu=cortex-m4 -mthumb -std=c99 '-DRETARGET_VCOM=1' '-DDEBUG_EFM=1' '-DEFM32PG12B500F1024GL125=1' -I"C:\Users\thwaitester\Desktop\ECEN3360_DDL\MyLab\JT_Course_Project\src\Header_files" -I"C:\Users\thwaitester\Desktop\ECEN3360_DDL\MyLab\JT_Course_Project\src\Source_files" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//platform/emlib/inc" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//platform/CMSIS/Include" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//hardware/kit/SLSTK3402A_EFM32PG12/config" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//hardware/kit/common/bsp" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//platform/Device/SiliconLabs/EFM32PG12B/Include" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//hardware/kit/common/drivers" -O2 -Wall -c -fmessage-length=0 -ffunction-sections -fdata-sections -mfpu=fpv4-sp-d16 -mfloat-abi=softfp -MMD -MP -MF"src/Source_files/bench.d" -MT"src/Source_files/bench.o" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
 src/Source_files/ble.o: ../src/Source_files/ble.c
 	@echo 'Building file: $<'
 	@echo 'Invoking: GNU ARM C Compiler'
@@ -72,6 +138,13 @@ src/Source_files/ble.o: ../src/Source_files/ble.c
 	@echo 'Finished building: $<'
 	@echo ' '
 
+src/Source_files/change.o: ../src/Source_files/change.c
+	@echo 'Building file: $<'
+	@echo 'Invoking: GNU ARM C Compiler'
+	arm-none-eabi-gcc -g3 -gdwarf-2 -mcpu=cortex-m4 -mthumb -std=c99 '-DRETARGET_VCOM=1' '-DDEBUG_EFM=1' '-DEFM32PG12B500F1024GL125=1' -I"C:\Users\thwaitester\Desktop\ECEN3360_DDL\MyLab\JT_Course_Project\src\Header_files" -I"C:\Users\thwaitester\Desktop\ECEN3360_DDL\MyLab\JT_Course_Project\src\Source_files" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//platform/emlib/inc" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//platform/CMSIS/Include" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//hardware/kit/SLSTK3402A_EFM32PG12/config" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//hardware/kit/common/bsp" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//platform/Device/SiliconLabs/EFM32PG12B/Include" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//hardware/kit/common/drivers" -O2 -Wall -c -fmessage-length=0 -ffunction-sections -fdata-sections -mfpu=fpv4-sp-d16 -mfloat-abi=softfp -MMD -MP -MF"src/Source_files/change.d" -MT"src/Source_files/change.o" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
 src/Source_files/cmu.o: ../src/Source_files/cmu.c
 	@echo 'Building file: $<'
 	@echo 'Invoking: GNU ARM C Compiler'
@@ -79,6 +152,62 @@ src/Source_files/cmu.o: ../src/Source_files/cmu.c
 	@echo 'Finished building: $<'
 	@echo ' '
 
+src/Source_files/cobs.o: ../src/Source_files/cobs.c
+	@echo 'Building file: $<'
+	@echo 'Invoking: GNU ARM C Compiler'
+	arm-none-eabi-gcc -g3 -gdwarf-2 -mcpu=cortex-m4 -mthumb -std=c99 '-DRETARGET_VCOM=1' '-DDEBUG_EFM=1' '-DEFM32PG12B500F1024GL125=1' -I"C:\Users\thwaitester\Desktop\ECEN3360_DDL\MyLab\JT_Course_Project\src\Header_files" -I"C:\Users\thwaitester\Desktop\ECEN3360_DDL\MyLab\JT_Course_Project\src\Source_files" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//platform/emlib/inc" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//platform/CMSIS/Include" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//hardware/kit/SLSTK3402A_EFM32PG12/config" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//hardware/kit/common/bsp" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//platform/Device/SiliconLabs/EFM32PG12B/Include" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//hardware/kit/common/drivers" -O2 -Wall -c -fmessage-length=0 -ffunction-sections -fdata-sections -mfpu=fpv4-sp-d16 -mfloat-abi=softfp -MMD -MP -MF"src/Source_files/cobs.d" -MT"src/Source_files/cobs.o" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+src/Source_files/codec.o: ../src/Source_files/codec.c
+	@echo 'Building file: $<'
+	@echo 'Invoking: GNU ARM C Compiler'
+	arm-none-eabi-gcc -g3 -gdwarf-2 -mcpu=cortex-m4 -mthumb -std=c99 '-DRETARGET_VCOM=1' '-DDEBUG_EFM=1' '-DEFM32PG12B500F1024GL125=1' -I"C:\Users\thwaitester\Desktop\ECEN3360_DDL\MyLab\JT_Course_Project\src\Header_files" -I"C:\Users\thwaitester\Desktop\ECEN3360_DDL\MyLab\JT_Course_Project\src\Source_files" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//platform/emlib/inc" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//platform/CMSIS/Include" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//hardware/kit/SLSTK3402A_EFM32PG12/config" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//hardware/kit/common/bsp" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//platform/Device/SiliconLabs/EFM32PG12B/Include" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//hardware/kit/common/drivers" -O2 -Wall -c -fmessage-length=0 -ffunction-sections -fdata-sections -mfpu=fpv4-sp-d16 -mfloat-abi=softfp -MMD -MP -MF"src/Source_files/codec.d" -MT"src/Source_files/codec.o" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+src/Source_files/command.o: ../src/Source_files/command.c
+	@echo 'Building file: $<'
+	@echo 'Invoking: GNU ARM C Compiler'
+	arm-none-eabi-gcc -g3 -gdwarf-2 -mcpu=cortex-m4 -mthumb -std=c99 '-DRETARGET_VCOM=1' '-DDEBUG_EFM=1' '-DEFM32PG12B500F1024GL125=1' -I"C:\Users\thwaitester\Desktop\ECEN3360_DDL\MyLab\JT_Course_Project\src\Header_files" -I"C:\Users\thwaitester\Desktop\ECEN3360_DDL\MyLab\JT_Course_Project\src\Source_files" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//platform/emlib/inc" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//platform/CMSIS/Include" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//hardware/kit/SLSTK3402A_EFM32PG12/config" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//hardware/kit/common/bsp" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//platform/Device/SiliconLabs/EFM32PG12B/Include" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//hardware/kit/common/drivers" -O2 -Wall -c -fmessage-length=0 -ffunction-sections -fdata-sections -mfpu=fpv4-sp-d16 -mfloat-abi=softfp -MMD -MP -MF"src/Source_files/command.d" -MT"src/Source_files/command.o" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+src/Source_files/config.o: ../src/Source_files/config.c
+	@echo 'Building file: $<'
+	@echo 'Invoking: GNU ARM C Compiler'
+	arm-none-eabi-gcc -g3 -gdwarf-2 -mcpu=cortex-m4 -mthumb -std=c99 '-DRETARGET_VCOM=1' '-DDEBUG_EFM=1' '-DEFM32PG12B500F1024GL125=1' -I"C:\Users\thwaitester\Desktop\ECEN3360_DDL\MyLab\JT_Course_Project\src\Header_files" -I"C:\Users\thwaitester\Desktop\ECEN3360_DDL\MyLab\JT_Course_Project\src\Source_files" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//platform/emlib/inc" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//platform/CMSIS/Include" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//hardware/kit/SLSTK3402A_EFM32PG12/config" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//hardware/kit/common/bsp" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//platform/Device/SiliconLabs/EFM32PG12B/Include" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//hardware/kit/common/drivers" -O2 -Wall -c -fmessage-length=0 -ffunction-sections -fdata-sections -mfpu=fpv4-sp-d16 -mfloat-abi=softfp -MMD -MP -MF"src/Source_files/config.d" -MT"src/Source_files/config.o" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+src/Source_files/filter.o: ../src/Source_files/filter.c
+	@echo 'Building file: $<'
+	@echo 'Invoking: GNU ARM C Compiler'
+	arm-none-eabi-gcc -g3 -gdwarf-2 -mcpu=cortex-m4 -mthumb -std=c99 '-DRETARGET_VCOM=1' '-DDEBUG_EFM=1' '-DEFM32PG12B500F1024GL125=1' -I"C:\Users\thwaitester\Desktop\ECEN3360_DDL\MyLab\JT_Course_Project\src\Header_files" -I"C:\Users\thwaitester\Desktop\ECEN3360_DDL\MyLab\JT_Course_Project\src\Source_files" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//platform/emlib/inc" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//platform/CMSIS/Include" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//hardware/kit/SLSTK3402A_EFM32PG12/config" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//hardware/kit/common/bsp" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//platform/Device/SiliconLabs/EFM32PG12B/Include" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//hardware/kit/common/drivers" -O2 -Wall -c -fmessage-length=0 -ffunction-sections -fdata-sections -mfpu=fpv4-sp-d16 -mfloat-abi=softfp -MMD -MP -MF"src/Source_files/filter.d" -MT"src/Source_files/filter.o" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+src/Source_files/flash_log.o: ../src/Source_files/flash_log.c
+	@echo 'Building file: $<'
+	@echo 'Invoking: GNU ARM C Compiler'
+	arm-none-eabi-gcc -g3 -gdwarf-2 -mcpu=cortex-m4 -mthumb -std=c99 '-DRETARGET_VCOM=1' '-DDEBUG_EFM=1' '-DEFM32PG12B500F1024GL125=1' -I"C:\Users\thwaitester\Desktop\ECEN3360_DDL\MyLab\JT_Course_Project\src\Header_files" -I"C:\Users\thwaitester\Desktop\ECEN3360_DDL\MyLab\JT_Course_Project\src\Source_files" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//platform/emlib/inc" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//platform/CMSIS/Include" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//hardware/kit/SLSTK3402A_EFM32PG12/config" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//hardware/kit/common/bsp" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//platform/Device/SiliconLabs/EFM32PG12B/Include" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//hardware/kit/common/drivers" -O2 -Wall -c -fmessage-length=0 -ffunction-sections -fdata-sections -mfpu=fpv4-sp-d16 -mfloat-abi=softfp -MMD -MP -MF"src/Source_files/flash_log.d" -MT"src/Source_files/flash_log.o" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+src/Source_files/format.o: ../src/Source_files/format.c
+	@echo 'Building file: $<'
+	@echo 'Invoking: GNU ARM C Compiler'
+	arm-none-eabi-gcc -g3 -gdwarf-2 -mcpu=cortex-m4 -mthumb -std=c99 '-DRETARGET_VCOM=1' '-DDEBUG_EFM=1' '-DEFM32PG12B500F1024GL125=1' -I"C:\Users\thwaitester\Desktop\ECEN3360_DDL\MyLab\JT_Course_Project\src\Header_files" -I"C:\Users\thwaitester\Desktop\ECEN3360_DDL\MyLab\JT_Course_Project\src\Source_files" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//platform/emlib/inc" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//platform/CMSIS/Include" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//hardware/kit/SLSTK3402A_EFM32PG12/config" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//hardware/kit/common/bsp" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//platform/Device/SiliconLabs/EFM32PG12B/Include" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//hardware/kit/common/drivers" -O2 -Wall -c -fmessage-length=0 -ffunction-sections -fdata-sections -mfpu=fpv4-sp-d16 -mfloat-abi=softfp -MMD -MP -MF"src/Source_files/format.d" -MT"src/Source_files/format.o" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+src/Source_files/gpcrc.o: ../src/Source_files/gpcrc.c
+	@echo 'Building file: $<'
+	@echo 'Invoking: GNU ARM C Compiler'
+	arm-none-eabi-gcc -g3 -gdwarf-2 -mcpu=cortex-m4 -mthumb -std=c99 '-DRETARGET_VCOM=1' '-DDEBUG_EFM=1' '-DEFM32PG12B500F1024GL125=1' -I"C:\Users\thwaitester\Desktop\ECEN3360_DDL\MyLab\JT_Course_Project\src\Header_files" -I"C:\Users\thwaitester\Desktop\ECEN3360_DDL\MyLab\JT_Course_Project\src\Source_files" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//platform/emlib/inc" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//platform/CMSIS/Include" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//hardware/kit/SLSTK3402A_EFM32PG12/config" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//hardware/kit/common/bsp" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//platform/Device/SiliconLabs/EFM32PG12B/Include" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//hardware/kit/common/drivers" -O2 -Wall -c -fmessage-length=0 -ffunction-sections -fdata-sections -mfpu=fpv4-sp-d16 -mfloat-abi=softfp -MMD -MP -MF"src/Source_files/gpcrc.d" -MT"src/Source_files/gpcrc.o" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
 src/Source_files/gpio.o: ../src/Source_files/gpio.c
 	@echo 'Building file: $<'
 	@echo 'Invoking: GNU ARM C Compiler'
@@ -121,4 +250,25 @@ src/Source_files/sleep_routines.o: ../src/Source_files/sleep_routines.c
 	@echo 'Finished building: $<'
 	@echo ' '
 
+src/Source_files/spsc_ring.o: ../src/Source_files/spsc_ring.c
+	@echo 'Building file: $<'
+	@echo 'Invoking: GNU ARM C Compiler'
+	arm-none-eabi-gcc -g3 -gdwarf-2 -mcpu=cortex-m4 -mthumb -std=c99 '-DRETARGET_VCOM=1' '-DDEBUG_EFM=1' '-DEFM32PG12B500F1024GL125=1' -I"C:\Users\thwaitester\Desktop\ECEN3360_DDL\MyLab\JT_Course_Project\src\Header_files" -I"C:\Users\thwaitester\Desktop\ECEN3360_DDL\MyLab\JT_Course_Project\src\Source_files" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//platform/emlib/inc" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//platform/CMSIS/Include" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//hardware/kit/SLSTK3402A_EFM32PG12/config" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//hardware/kit/common/bsp" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//platform/Device/SiliconLabs/EFM32PG12B/Include" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//hardware/kit/common/drivers" -O2 -Wall -c -fmessage-length=0 -ffunction-sections -fdata-sections -mfpu=fpv4-sp-d16 -mfloat-abi=softfp -MMD -MP -MF"src/Source_files/spsc_ring.d" -MT"src/Source_files/spsc_ring.o" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+src/Source_files/stats.o: ../src/Source_files/stats.c
+	@echo 'Building file: $<'
+	@echo 'Invoking: GNU ARM C Compiler'
+	arm-none-eabi-gcc -g3 -gdwarf-2 -mcpu=cortex-m4 -mthumb -std=c99 '-DRETARGET_VCOM=1' '-DDEBUG_EFM=1' '-DEFM32PG12B500F1024GL125=1' -I"C:\Users\thwaitester\Desktop\ECEN3360_DDL\MyLab\JT_Course_Project\src\Header_files" -I"C:\Users\thwaitester\Desktop\ECEN3360_DDL\MyLab\JT_Course_Project\src\Source_files" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//platform/emlib/inc" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//platform/CMSIS/Include" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//hardware/kit/SLSTK3402A_EFM32PG12/config" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//hardware/kit/common/bsp" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//platform/Device/SiliconLabs/EFM32PG12B/Include" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//hardware/kit/common/drivers" -O2 -Wall -c -fmessage-length=0 -ffunction-sections -fdata-sections -mfpu=fpv4-sp-d16 -mfloat-abi=softfp -MMD -MP -MF"src/Source_files/stats.d" -MT"src/Source_files/stats.o" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+src/Source_files/usart.o: ../src/Source_files/usart.c
+	@echo 'Building file: $<'
+	@echo 'Invoking: GNU ARM C Compiler'
+	arm-none-eabi-gcc -g3 -gdwarf-2 -mcpu=cortex-m4 -mthumb -std=c99 '-DRETARGET_VCOM=1' '-DDEBUG_EFM=1' '-DEFM32PG12B500F1024GL125=1' -I"C:\Users\thwaitester\Desktop\ECEN3360_DDL\MyLab\JT_Course_Project\src\Header_files" -I"C:\Users\thwaitester\Desktop\ECEN3360_DDL\MyLab\JT_Course_Project\src\Source_files" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//platform/emlib/inc" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//platform/CMSIS/Include" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//hardware/kit/SLSTK3402A_EFM32PG12/config" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//hardware/kit/common/bsp" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//platform/Device/SiliconLabs/EFM32PG12B/Include" -I"C:/SiliconLabs/SimplicityStudio/v4/developer/sdks/gecko_sdk_suite/v2.5//hardware/kit/common/drivers" -O2 -Wall -c -fmessage-length=0 -ffunction-sections -fdata-sections -mfpu=fpv4-sp-d16 -mfloat-abi=softfp -MMD -MP -MF"src/Source_files/usart.d" -MT"src/Source_files/usart.o" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
 
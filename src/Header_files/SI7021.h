@@ -13,13 +13,13 @@
 
 #include "gpio.h"
 #include "i2c.h"
+#include "config.h"
 
 //***********************************************************************************
 // defined files
 //***********************************************************************************
 #define 	Si7021_dev_addr				0x40
 #define 	SI7021_TEMP_NO_HOLD			0xF3
-#define 	SI7021_I2C_FREQ				I2C_FREQ_FAST_MAX//400000 //Hz
 #define 	SI7021_I2C_CLK_RATIO		i2cClockHLRAsymetric
 #define 	SI7021_SCL_LOC				I2C_ROUTELOC0_SCLLOC_LOC15
 #define 	SI7021_SCL_EN				true
@@ -30,6 +30,25 @@
 
 #define		SI7021_BYTES				2
 
+// Datasheet conversions in hundredths, rounded to nearest:
+// C = 175.72 * code / 65536 - 46.85, F = 9 / 5 * C + 32, RH = 125 * code / 65536 - 6
+#define		SI7021_CENTI_C_MUL			17572
+#define		SI7021_CENTI_C_OFFSET		4685
+#define		SI7021_CENTI_F_MUL			39537		// 9 * 17572 / 4, over 81920 = 5 * 65536 / 4
+#define		SI7021_CENTI_F_DIV			81920
+#define		SI7021_CENTI_F_OFFSET		5233		// 9 / 5 * 4685 - 3200
+#define		SI7021_CENTI_RH_MUL			12500
+#define		SI7021_CENTI_RH_OFFSET		600
+#define		SI7021_CODE_SHIFT			16
+#define		SI7021_CODES				65536
+
+//#define SI7021_TEST_ENABLED
+
+typedef struct {
+	uint32_t	float_cycles;		// per sample, the former float C then F conversion
+	uint32_t	int_cycles;			// per sample, si7021_code_centi_f()
+} SI7021_TEST_RESULT;
+
 
 
 
@@ -44,8 +63,14 @@
 //***********************************************************************************
 
 void si7021_i2c_open(uint32_t evt);
-float si7021_i2c_data();
+uint32_t si7021_temp_code(void);
+int32_t si7021_temp_centi_c(void);
+int32_t si7021_temp_centi_f(void);
+int32_t si7021_code_centi_c(uint32_t code);
+int32_t si7021_code_centi_f(uint32_t code);
+int32_t si7021_code_centi_rh(uint32_t code);
 void si7021_read_temp();
+void si7021_conversion_test(SI7021_TEST_RESULT *result);
 
 
 #endif /* SRC_HEADER_FILES_SI7021_H_ */
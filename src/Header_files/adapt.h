@@ -0,0 +1,66 @@
+/*
+ * adapt.h
+ *
+ *  Created on: May 30, 2020
+ *      Author: Justin Thwaites
+ */
+
+#ifndef SRC_HEADER_FILES_ADAPT_H_
+#define SRC_HEADER_FILES_ADAPT_H_
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "em_assert.h"
+#include "command.h"
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define ADAPT_MIN_LIMIT			500		// ms, shortest period the controller may choose
+#define ADAPT_MAX_LIMIT			60000	// ms, longest period, the config period limit
+#define ADAPT_DEFAULT_MIN		775		// ms, a quarter of the 3.1 s period
+#define ADAPT_DEFAULT_MAX		12400	// ms, four times the 3.1 s period
+#define ADAPT_DEFAULT_BUDGET	3100	// ms, average period allowed, the energy of fixed 3.1 s sampling
+#define ADAPT_FAST_SLOPE		30		// hundredths of a degree F per minute that halve the period
+#define ADAPT_SLOW_SLOPE		10		// below this for ADAPT_SETTLE spans the period doubles
+#define ADAPT_NOISE				2		// hundredths of a degree a reading may move without a slope
+#define ADAPT_SETTLE			8
+#define ADAPT_SPAN				6000	// ms, shortest time the slope is measured over
+#define ADAPT_SLOPE_WEIGHT		2		// the slope is averaged over about 2^2 spans
+#define ADAPT_CREDIT_MAX		60000	// ms of budget saved while slow that a transient may spend
+#define ADAPT_MS_PER_MIN		60000
+#define ADAPT_ENABLE_MESSAGE	"Adapt"		// "Adapt=1" lets the controller choose the period
+#define ADAPT_MIN_MESSAGE		"Minperiod"	// "Minperiod=775" shortest period in ms
+#define ADAPT_MAX_MESSAGE		"Maxperiod"	// "Maxperiod=12400" longest period in ms
+#define ADAPT_BUDGET_MESSAGE	"Budget"	// "Budget=3100" average period in ms the energy allows
+#define ADAPT_STATS_MESSAGE		"Decisions"	// replies with the decision counters
+#define ADAPT_STATS_SIZE		64
+#define ADAPT_TEST_SAMPLES		64
+
+typedef struct {
+	uint32_t	faster;			// periods halved for a fast slope
+	uint32_t	slower;			// periods doubled for a flat slope
+	uint32_t	budget;			// periods doubled because the budget was spent
+	uint32_t	rejected;		// changes the apply callback refused
+} ADAPT_STATS;
+
+typedef bool (*ADAPT_APPLY_CB)(uint32_t period, uint32_t slope);
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void adapt_open(ADAPT_APPLY_CB apply, uint32_t base_period_ms);
+void adapt_sample(uint32_t time, int32_t value);
+void adapt_set_base(uint32_t period);
+bool adapt_set_enable(bool enable);
+bool adapt_set_limits(uint32_t min, uint32_t max);
+bool adapt_set_budget(uint32_t period);
+uint32_t adapt_period(void);
+void adapt_stats(ADAPT_STATS *stats);
+void adapt_test(void);
+
+#endif /* SRC_HEADER_FILES_ADAPT_H_ */
@@ -10,14 +10,48 @@
 #include "gpio.h"
 #include "ble.h"
 #include "scheduler.h"
-#include <stdio.h>
+#include "batch.h"
+#include "change.h"
+#include "filter.h"
+#include "stats.h"
+#include "codec.h"
+#include "flash_log.h"
+#include "format.h"
+#include "config.h"
+#include "adapt.h"
+#include "letimer.h"
 
 //***********************************************************************************
 // defined files
 //***********************************************************************************
 //#define BLE_TEST_ENABLED
-#define		PWM_PER				3.1		// PWM period in seconds
-#define		PWM_ACT_PER			0.10	// PWM active period in seconds
+#define		PWM_US_PER_MS		1000	// the PWM period and active time are configured in ms, see config.h
+#define		PWM_MAX_PERIOD		ADAPT_MAX_LIMIT	// ms, longest period set at run time, selects the LETIMER prescaler
+_Static_assert(CONFIG_PERIOD_MAX <= PWM_MAX_PERIOD, "the configured period must fit the LETIMER prescaler");
+_Static_assert(LETIMER_PERIOD_FITS((uint64_t)PWM_MAX_PERIOD * PWM_US_PER_MS, LETIMER_NOMINAL_HZ), "PWM_MAX_PERIOD does not fit the LETIMER");
+_Static_assert(LETIMER_PERIOD_FITS((uint64_t)ADAPT_MIN_LIMIT * PWM_US_PER_MS, LETIMER_NOMINAL_HZ), "ADAPT_MIN_LIMIT is too short for the LETIMER");
+_Static_assert(LETIMER_PERIOD_FITS((uint64_t)CONFIG_PERIOD_DEFAULT * PWM_US_PER_MS, LETIMER_NOMINAL_HZ), "CONFIG_PERIOD_DEFAULT does not fit the LETIMER");
+#define		TEMP_MSG_SIZE		16		// "Temp = 100.0 F\n" and the NUL
+#define		TEMP_MSG_PREFIX		"Temp = "
+#define		TEMP_MSG_C			" C\n"
+#define		TEMP_MSG_F			" F\n"
+#define		TEMP_FIELD_WIDTH	4
+#define		TEMP_MSG_TIME		" @"	// "Temp = 72.5 F @123400\n", ms of the sample on each line of a batch
+#define		TEMP_LINE_SIZE		(TEMP_MSG_SIZE - 1 + sizeof(TEMP_MSG_TIME) - 1 + FORMAT_UINT_MAX_LEN)
+#define		TEMP_BATCH_MSG_SIZE	(BATCH_MAX_SAMPLES * TEMP_LINE_SIZE + 1)
+#define		TEMP_SAMPLE_INTERVAL	adapt_period()	// ms, the nominal step of a packed batch
+#define		TEMP_BACKFILL_SPACE	(TEMP_BATCH_MSG_SIZE + 16)	// free bulk lane bytes to send a logged batch, with record overhead
+#define		ADAPT_LOG_SIZE		48		// "Adapt period=1550 slope=72\n" sent when the period changes
+#define		CODEC_REPORT_SIZE	64		// packed and text sizes sent at boot with CODEC_BENCH_ENABLED
+#define		TEMP_STATS_MSG_SIZE	64		// "Stats n=100 min=70.1 max=72.3 mean=71.2 sd=0.4 F\n" and the NUL
+#define		TEMP_STATS_FRAME_SIZE	(sizeof(uint16_t) + 4 * sizeof(int16_t))
+#define		TEMP_CENTI_F_ZERO	3200	// 0 C in hundredths of a degree F
+#define		BLE_MODULE_NAME		"JTBLE"
+#define		TEMP_FILTER_DEFAULT	"M3"	// median of 3 drops a single noisy reading, see filter_configure()
+#define		TEMP_ALERT_CENTI_F	8000	// 80 F, turns on LED1 and sends TEMP_ALERT_MSG, cleared below 80 F less the change delta
+#define		TEMP_ALERT_MSG		"ALERT Temp >= 80 F\n"
+#define		SI7021_REPORT_SIZE	64		// conversion and format cycles sent at boot with SI7021_TEST_ENABLED
+#define		TEMP_BENCH_SAMPLES	1000	// temperatures formatted to time app_format_temp()
 #define		LETIMER0_ROUTE_OUT0	LETIMER_ROUTELOC0_OUT0LOC_LOC28
 #define		LETIMER0_OUT0_EN	false
 #define		LETIMER0_ROUTE_OUT1	0
@@ -31,6 +65,7 @@
 #define BOOT_UP_EVT				0x00000010 //0b0010000
 #define LEUART0_TX_DONE_EVT		0x00000020 //0b0100000
 #define LEUART0_RX_DONE_EVT		0x00000040 //0b1000000
+#define BLE_AT_DONE_EVT			0x00000080 //0b10000000
 #define ENABLE_IRQ 				true
 #define DISABLE_IRQ 			false
 
@@ -51,9 +86,10 @@ void scheduled_letimer0_comp0_evt(void);
 void scheduled_letimer0_comp1_evt(void);
 void scheduled_si7021_done_evt(void);
 void app_peripheral_setup(void);
-void app_letimer_pwm_open(float period, float act_period);
+void app_letimer_pwm_open(uint32_t period, uint32_t act_period);
 void scheduled_boot_up_evt(void);
 void leuart0_tx_done_evt(void);
 void leuart0_rx_done_evt(void);
+void scheduled_ble_at_done_evt(void);
 
 #endif
@@ -0,0 +1,48 @@
+/*
+ * batch.h
+ *
+ *  Created on: May 22, 2020
+ *      Author: Justin Thwaites
+ */
+
+#ifndef SRC_HEADER_FILES_BATCH_H_
+#define SRC_HEADER_FILES_BATCH_H_
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "em_assert.h"
+#include "command.h"
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define BATCH_MAX_SAMPLES		8
+#define BATCH_DEFAULT_SAMPLES	4
+#define BATCH_MAX_LATENCY		60000	// ms, keeps the sample offsets of a binary batch in 16 bits
+#define BATCH_DEFAULT_LATENCY	15000	// ms from the first sample of a batch to its flush
+#define BATCH_SIZE_MESSAGE		"Batch"		// "Batch=4" sets the samples per transmission
+#define BATCH_LATENCY_MESSAGE	"Latency"	// "Latency=15000" sets the deadline in ms
+
+typedef struct {
+	uint32_t	time;		// ms, letimer_ms() when the sample was taken
+	int32_t		value;
+} BATCH_SAMPLE;
+
+typedef void (*BATCH_FLUSH_CB)(const BATCH_SAMPLE *samples, uint32_t count);
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void batch_open(BATCH_FLUSH_CB flush);
+void batch_add(uint32_t time, int32_t value);
+void batch_flush(void);
+bool batch_set_size(uint32_t samples);
+bool batch_set_latency(uint32_t ms);
+uint32_t batch_size(void);
+uint32_t batch_latency(void);
+
+#endif /* SRC_HEADER_FILES_BATCH_H_ */
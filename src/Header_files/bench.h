@@ -0,0 +1,15 @@
+#ifndef BENCH_H
+#define	BENCH_H
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include <stdint.h>
+#include "em_device.h"
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void bench_open(void);
+uint32_t bench_cycles(void);
+
+#endif
@@ -16,13 +16,20 @@
 #include <stdint.h>
 
 #include "leuart.h"
+#include "usart.h"
+#include "gpcrc.h"
+#include "cobs.h"
+#include "command.h"
+#include "spsc_ring.h"
+#include "letimer.h"
+#include "config.h"
+#include "flash_log.h"
 
 //***********************************************************************************
 // defined files
 //***********************************************************************************
 
 #define HM10_LEUART0		LEUART0
-#define HM10_BAUDRATE		9600
 #define	HM10_DATABITS		leuartDatabits8
 #define HM10_ENABLE			leuartEnable
 #define HM10_PARITY			leuartNoParity
@@ -32,13 +39,192 @@
 #define LEUART0_TX_ROUTE	LEUART_ROUTELOC0_TXLOC_LOC18
 #define LEUART0_RX_ROUTE	LEUART_ROUTELOC0_RXLOC_LOC18
 
+// High-throughput transport, USART0 routed to the same PD10/PD11 pins as LEUART0
+#define HM10_USART			USART0
+#define HM10_FAST_BAUDRATE	115200
+#define	HM10_USART_DATABITS	usartDatabits8
+#define HM10_USART_ENABLE	usartEnable
+#define HM10_USART_PARITY	usartNoParity
+#define HM10_USART_STOPBITS	usartStopbits1
+#define USART0_TX_ROUTE		USART_ROUTELOC0_TXLOC_LOC18
+#define USART0_RX_ROUTE		USART_ROUTELOC0_RXLOC_LOC18
+
+// HM10 baud rate negotiation, AT+BAUD0 = 9600, AT+BAUD4 = 115200
+#define HM10_BAUD_CMD		"AT+BAUD"	// followed by the code of the baud rate
+#define HM10_BAUD_RESP		"OK+Set:"
+#define HM10_BAUD_FAST_CODE	'4'
+#define HM10_RESET_CMD		"AT+RESET"
+#define HM10_RESET_RESP		"OK+RESET"
+#define HM10_RESET_DELAY	500		// ms for the HM10 to restart with the new baud rate, nothing is sent meanwhile
+#define HM10_PROBE_TRIES	4		// alternate attempts at each rate to find the HM10 after a reset at the fast rate
+
+// Asynchronous AT command engine
+#define HM10_AT_CMD			"AT"
+#define HM10_AT_RESP		"OK"
+#define HM10_NAME_CMD		"AT+Name"
+#define HM10_NAME_RESP		"OK+Set:"
+#define BLE_AT_QUEUE_SIZE	6
+#define BLE_AT_CMD_SIZE		32
+#define BLE_AT_TIMEOUT		1000	// ms, detected on the next rx or LETIMER UF event after it expires
+#define BLE_AT_TIMER		LETIMER0
+
+// Connection notifications, enabled with AT+NOTI1
+#define HM10_NOTI_CMD		"AT+NOTI1"
+#define HM10_NOTI_RESP		"OK+Set:1"
+#define HM10_CONN_NOTE		"OK+CONN"
+#define HM10_LOST_NOTE		"OK+LOST"
+#define BLE_DISCONNECT_DEFAULT	BLE_DISCONNECT_DROP
+
+// HM10 sleep, the module can only sleep while no central is connected
+#define HM10_SLEEP_CMD		"AT+SLEEP"
+#define HM10_SLEEP_RESP		"OK+SLEEP"
+#define HM10_WAKE_RESP		"OK+WAKE"
+#define HM10_WAKE_LEN		81		// a string longer than 80 characters wakes the module
+#define HM10_WAKE_CHAR		'I'
+#define HM10_AUTO_SLEEP_CMD		"AT+PWRM0"	// takes effect after AT+RESET
+#define HM10_AUTO_SLEEP_RESP	"OK+Set:0"
+#define HM10_NO_AUTO_SLEEP_CMD	"AT+PWRM1"
+#define HM10_NO_AUTO_SLEEP_RESP	"OK+Set:1"
+#define BLE_MODULE_SLEEP_DEFAULT	true
+#define BLE_BULK_THRESHOLD	48		// bytes held while disconnected that move the link to the fast transport
+#define BLE_BULK_LOG_SAMPLES	FLASH_LOG_RECORDS	// samples logged while disconnected that do the same, a page of backfill
+
 #define CIRC_TEST_SIZE		3
 #define CIRC_TEST 			true
 #define CIRC_OPER 			false
-#define CSIZE 				64
+#define BLE_CIRC_SIZE		512						// must be a power of two, twice the largest message, a full text batch
+#define BLE_CIRC_MASK		(BLE_CIRC_SIZE - 1)
+_Static_assert((BLE_CIRC_SIZE & BLE_CIRC_MASK) == 0, "BLE_CIRC_SIZE must be a power of two");
+
+#define BLE_ALERT_CIRC_SIZE	64						// must be a power of two
+_Static_assert((BLE_ALERT_CIRC_SIZE & (BLE_ALERT_CIRC_SIZE - 1)) == 0, "BLE_ALERT_CIRC_SIZE must be a power of two");
+#define BLE_STAMP_SIZE		4						// enqueue timestamp in front of each queued message
+#define BLE_STAMP_TIMER		LETIMER0
+#define BLE_STARVATION_LIMIT	4					// alert transfers in a row before bulk gets a turn
+#define BLE_TX_BURST		BLE_CIRC_SIZE			// most characters sent as one transfer
+#define BLE_BLOCK_TIMEOUT	100						// ms a blocking write waits for room
+#define BLE_OVERFLOW_DEFAULT	BLE_OVERFLOW_OVERWRITE_TELEMETRY
+
+//#define BLE_BENCH_ENABLED
+#define BLE_BENCH_MSG_LEN	32
+#define BLE_BENCH_ROUNDS	256
 
 #define CELSIUS_MESSAGE		"Celsius"
 #define FAHRENHEIT_MESSAGE	"Fahrenheit"
+#define BINARY_MESSAGE		"Binary"
+#define TEXT_MESSAGE		"Text"
+#define FAST_LINK_MESSAGE	"Fastlink"	// "Fastlink=1" lets the backlog move the link to the USART
+#define OVERFLOW_MESSAGE	"Overflow"	// "Overflow=2" selects a BLE_OVERFLOW_POLICY by its value
+#define DROPS_MESSAGE		"Drops"		// replies with the overflow counters
+#define LANES_MESSAGE		"Lanes"		// replies with the counters and latency of each lane
+#define DISCONNECT_MESSAGE	"Disconnect"	// "Disconnect=1" selects a BLE_DISCONNECT_POLICY by its value
+#define CONN_MESSAGE		"Conn"		// replies with the connection counters
+#define SLEEP_MESSAGE		"Sleep"		// "Sleep=1" puts the HM10 to sleep while idle and disconnected
+#define AUTO_SLEEP_MESSAGE	"Autosleep"	// "Autosleep=1" lets the HM10 sleep by itself, from the next disconnection
+#define BAUD_MESSAGE		"Baud"		// "Baud=4800" moves the HM10 and the LEUART to a new rate, from the next disconnection
+
+// Binary frame: COBS(type, length, payload, CRC-16 MSB first) followed by a 0x00 delimiter
+#define BLE_FRAME_HEADER		2
+#define BLE_FRAME_CRC			2
+#define BLE_FRAME_MAX_PAYLOAD	48
+#define BLE_FRAME_TEMP			0x01	// int16_t centi-degrees Celsius, little endian
+#define BLE_FRAME_CMD			0x02	// command string, same commands as the text protocol
+#define BLE_FRAME_REPLY			0x03	// reply string to a command
+#define BLE_FRAME_ALERT			0x04	// alert string, sent on the alert lane
+#define BLE_FRAME_TEMP_BATCH	0x05	// codec block of centi-C samples with ms timestamps, see codec.h
+#define BLE_FRAME_TEMP_STATS	0x06	// uint16_t samples, then int16_t min, max, mean and stddev in centi-C
+
+#define BLE_REPLY_SIZE			32
+#define BLE_STATS_SIZE			80		// a counter reply with every counter at ten digits
+#define CMD_UNKNOWN_REPLY		"ERR unknown "
+#define CMD_BAD_ARG_REPLY		"ERR arg "
+#define CMD_ERROR_REPLY			"ERR failed "
+
+typedef struct {
+	uint32_t	baud;
+	char		code;			// digit of AT+BAUD for the baud rate
+} BLE_BAUD_CODE;
+
+typedef enum {
+	BLE_TRANSPORT_LEUART,
+	BLE_TRANSPORT_USART
+} BLE_TRANSPORT;
+
+typedef enum {
+	BLE_PROTOCOL_TEXT,
+	BLE_PROTOCOL_BINARY
+} BLE_PROTOCOL;
+
+typedef enum {
+	BLE_MSG_TELEMETRY,		// may be dropped to make room for newer messages
+	BLE_MSG_ALERT			// never dropped to make room
+} BLE_MSG_CLASS;
+
+typedef enum {
+	BLE_LANE_ALERT,			// always sent first
+	BLE_LANE_BULK,			// telemetry, banner and replies
+	BLE_LANES
+} BLE_LANE;
+
+typedef struct {
+	uint32_t	messages;
+	uint32_t	latency_sum;	// ms from queued to sent
+	uint32_t	latency_max;	// ms from queued to sent
+	uint32_t	passed;			// transfers sent from the other lane while this one waited
+} BLE_LANE_STATS;
+
+typedef enum {
+	BLE_OVERFLOW_DROP_NEWEST,
+	BLE_OVERFLOW_DROP_OLDEST,
+	BLE_OVERFLOW_OVERWRITE_TELEMETRY,
+	BLE_OVERFLOW_BLOCK
+} BLE_OVERFLOW_POLICY;
+
+typedef struct {
+	uint32_t	dropped_newest;
+	uint32_t	dropped_oldest;
+	uint32_t	overwritten_telemetry;
+	uint32_t	block_timeouts;		// blocking writes that gave up, timed out or with nothing being sent
+} BLE_DROP_STATS;
+
+typedef enum {
+	BLE_DISCONNECT_DROP,		// telemetry is dropped before it is formatted, alerts are held
+	BLE_DISCONNECT_BUFFER		// everything is held, the overflow policy decides what is kept
+} BLE_DISCONNECT_POLICY;
+
+typedef struct {
+	uint32_t	connects;
+	uint32_t	disconnects;
+	uint32_t	suppressed;		// telemetry dropped while no central was connected
+	uint32_t	module_sleeps;
+	uint32_t	module_wakes;
+} BLE_CONN_STATS;
+
+typedef struct {
+	uint32_t	tx_frames;
+	uint32_t	rx_frames;
+	uint32_t	crc_errors;
+	uint32_t	framing_errors;
+} BLE_FRAME_STATS;
+
+typedef enum {
+	BLE_AT_IDLE,			// no command has been queued
+	BLE_AT_BUSY,			// commands are waiting for their responses
+	BLE_AT_OK,				// every command was answered
+	BLE_AT_TIMED_OUT		// a response did not arrive, the remaining commands were dropped
+} BLE_AT_STATUS;
+
+typedef struct {
+	char		cmd[BLE_AT_CMD_SIZE];
+	char		response[BLE_AT_CMD_SIZE];
+	uint32_t	timeout;		// ms
+	bool		wake;			// send the wake string instead of cmd
+} BLE_AT_CMD;
+
+typedef enum {
+	BLE_MODULE_AWAKE,
+	BLE_MODULE_ASLEEP			// must be woken before it reads AT commands
+} BLE_MODULE_STATE;
 
 typedef struct {
 	char test_str[CIRC_TEST_SIZE][64];
@@ -46,26 +232,44 @@ typedef struct {
 }CIRC_TEST_STRUCT;
 
 
-typedef struct {
-char cbuf[64];
-uint8_t size_mask;
-uint32_t size;
-uint32_t read_ptr;
-uint32_t write_ptr;
-} BLE_CIRCULAR_BUF;
-
 
 //***********************************************************************************
 // function prototypes
 //***********************************************************************************
-void ble_open(uint32_t tx_event, uint32_t rx_event);
+void ble_open(uint32_t tx_event, uint32_t rx_event, uint32_t at_event);
 void ble_write(char *string);
+void ble_write_alert(char *string);
+char *ble_reserve(uint32_t len, BLE_MSG_CLASS msg_class);
+void ble_commit(uint32_t len);
 void circular_buff_test(void);
-bool ble_test(char *mod_name);
 void ble_circ_init(void);
 void ble_circ_push(char *string);
 void circular_buff_test(void);
 bool ble_circ_pop(bool test);
 bool ble_mode_celsius(void);
 void ble_update_mode(void);
+bool ble_set_transport(BLE_TRANSPORT new_transport);
+BLE_TRANSPORT ble_transport(void);
+bool ble_set_baud(uint32_t baud);
+void ble_transport_auto(bool enable);
+void ble_write_frame(uint8_t type, uint8_t *payload, uint32_t len);
+void ble_set_protocol(BLE_PROTOCOL new_protocol);
+BLE_PROTOCOL ble_protocol(void);
+void ble_frame_stats(BLE_FRAME_STATS *stats);
+void ble_reply(char *reply);
+void ble_set_overflow_policy(BLE_OVERFLOW_POLICY policy);
+void ble_drop_stats(BLE_DROP_STATS *stats);
+void ble_lane_stats(BLE_LANE lane, BLE_LANE_STATS *stats);
+uint32_t ble_bulk_space(void);
+bool ble_at_queue(char *cmd, char *response, uint32_t timeout);
+bool ble_at_set_name(char *mod_name);
+void ble_at_poll(void);
+BLE_AT_STATUS ble_at_status(void);
+bool ble_connected(void);
+void ble_set_disconnect_policy(BLE_DISCONNECT_POLICY policy);
+void ble_conn_stats(BLE_CONN_STATS *stats);
+void ble_module_sleep(bool enable);
+bool ble_module_auto_sleep(bool enable);
+BLE_MODULE_STATE ble_module_state(void);
+void ble_circ_benchmark(void);
 #endif
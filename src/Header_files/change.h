@@ -0,0 +1,47 @@
+/*
+ * change.h
+ *
+ *  Created on: May 23, 2020
+ *      Author: Justin Thwaites
+ */
+
+#ifndef SRC_HEADER_FILES_CHANGE_H_
+#define SRC_HEADER_FILES_CHANGE_H_
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include <stdbool.h>
+#include <stdint.h>
+#include "em_assert.h"
+#include "command.h"
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define CHANGE_DEFAULT_DELTA		50		// hundredths of a degree F, also the LED1 hysteresis
+#define CHANGE_MAX_DELTA			1000
+#define CHANGE_DEFAULT_HEARTBEAT	100		// periods, about 5 minutes at 3.1 s
+#define CHANGE_MAX_HEARTBEAT		10000
+#define CHANGE_DELTA_MESSAGE		"Delta"		// "Delta=50" reports a move of more than 0.5 F
+#define CHANGE_HEARTBEAT_MESSAGE	"Heartbeat"	// "Heartbeat=100" reports at least every 100 periods
+#define CHANGE_STATS_MESSAGE		"Reports"	// replies with the sent and suppressed counters
+#define CHANGE_STATS_SIZE			48
+
+typedef struct {
+	uint32_t	sent;			// readings reported, heartbeats included
+	uint32_t	heartbeats;		// readings reported only because the heartbeat was due
+	uint32_t	suppressed;		// readings within the delta of the last report
+} CHANGE_STATS;
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void change_open(void);
+bool change_report(int32_t value, bool force);
+bool change_set_delta(uint32_t delta);
+bool change_set_heartbeat(uint32_t periods);
+int32_t change_delta(void);
+void change_stats(CHANGE_STATS *stats);
+
+#endif /* SRC_HEADER_FILES_CHANGE_H_ */
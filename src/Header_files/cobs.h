@@ -0,0 +1,29 @@
+/*
+ * cobs.h
+ *
+ *  Created on: May 6, 2020
+ *      Author: Justin Thwaites
+ */
+
+#ifndef SRC_HEADER_FILES_COBS_H_
+#define SRC_HEADER_FILES_COBS_H_
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include <stdbool.h>
+#include <stdint.h>
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define COBS_DELIMITER				0x00
+#define COBS_MAX_ENCODED(len)		((len) + ((len) / 254) + 1)	// worst case size without the delimiter
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+uint32_t cobs_encode(const uint8_t *src, uint32_t len, uint8_t *dst);
+bool cobs_decode(const uint8_t *src, uint32_t len, uint8_t *dst, uint32_t *dst_len);
+
+#endif /* SRC_HEADER_FILES_COBS_H_ */
@@ -0,0 +1,55 @@
+/*
+ * codec.h
+ *
+ *  Created on: May 26, 2020
+ *      Author: Justin Thwaites
+ */
+
+#ifndef SRC_HEADER_FILES_CODEC_H_
+#define SRC_HEADER_FILES_CODEC_H_
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include <stdbool.h>
+#include <stdint.h>
+#include "em_assert.h"
+#include "batch.h"
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define CODEC_VARINT_MAX		5		// bytes of a 32 bit varint
+#define CODEC_VARINT_BITS		7
+#define CODEC_VARINT_MORE		0x80
+#define CODEC_SAMPLE_MAX		(2 * CODEC_VARINT_MAX)		// value and time of one sample
+#define CODEC_HEADER_MAX		(2 * CODEC_VARINT_MAX)		// time of the first sample and the interval
+#define CODEC_TEST_SAMPLES		6
+#define CODEC_TEST_SIZE			(CODEC_HEADER_MAX + CODEC_TEST_SAMPLES * CODEC_SAMPLE_MAX)
+
+//#define CODEC_BENCH_ENABLED
+#define CODEC_BENCH_SAMPLES		32
+#define CODEC_BENCH_INTERVAL	3100	// ms between the samples of the trace
+#define CODEC_BENCH_TEXT_SIZE	32		// one formatted text sample
+
+typedef uint32_t (*CODEC_TEXT_CB)(char *buf, int32_t value);
+
+typedef struct {
+	uint32_t	samples;
+	uint32_t	text_bytes;			// whole trace, one string per sample
+	uint32_t	text_cycles;
+	uint32_t	packed_bytes;		// whole trace, one block
+	uint32_t	packed_cycles;
+} CODEC_BENCH_RESULT;
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+uint32_t codec_encode(const BATCH_SAMPLE *samples, uint32_t count, uint32_t interval,
+		uint8_t *dst, uint32_t size, uint32_t *encoded);
+bool codec_decode(const uint8_t *src, uint32_t len, BATCH_SAMPLE *samples, uint32_t max,
+		uint32_t *count, uint32_t *interval);
+void codec_test(void);
+void codec_benchmark(CODEC_TEXT_CB text, CODEC_BENCH_RESULT *result);
+
+#endif /* SRC_HEADER_FILES_CODEC_H_ */
@@ -0,0 +1,59 @@
+/*
+ * command.h
+ *
+ *  Created on: May 8, 2020
+ *      Author: Justin Thwaites
+ */
+
+#ifndef SRC_HEADER_FILES_COMMAND_H_
+#define SRC_HEADER_FILES_COMMAND_H_
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include <stdbool.h>
+#include <stdint.h>
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define CMD_TABLE_SIZE		64					// must be a power of two, kept under three quarters full
+#define CMD_TABLE_MASK		(CMD_TABLE_SIZE - 1)
+#define CMD_ARG_SEPARATOR	'='
+
+typedef enum {
+	CMD_ARG_NONE,		// "name"
+	CMD_ARG_INT,		// "name=-12", range checked against min and max
+	CMD_ARG_STRING		// "name=text"
+} CMD_ARG_TYPE;
+
+typedef enum {
+	CMD_OK,
+	CMD_UNKNOWN,
+	CMD_BAD_ARG,
+	CMD_ERROR
+} CMD_STATUS;
+
+typedef struct {
+	int32_t		value;
+	char		*string;
+} CMD_ARG;
+
+typedef CMD_STATUS (*CMD_HANDLER)(CMD_ARG *arg);
+
+typedef struct {
+	const char		*name;
+	CMD_ARG_TYPE	arg_type;
+	int32_t			min;
+	int32_t			max;
+	CMD_HANDLER		handler;
+} CMD_ENTRY;
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void command_open(void);
+void command_register(const CMD_ENTRY *entry);
+CMD_STATUS command_dispatch(char *message);
+
+#endif /* SRC_HEADER_FILES_COMMAND_H_ */
@@ -0,0 +1,82 @@
+/*
+ * config.h
+ *
+ *  Created on: May 29, 2020
+ *      Author: Justin Thwaites
+ */
+
+#ifndef SRC_HEADER_FILES_CONFIG_H_
+#define SRC_HEADER_FILES_CONFIG_H_
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "em_msc.h"
+#include "em_i2c.h"
+#include "em_assert.h"
+#include "command.h"
+#include "flash_log.h"
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define CONFIG_BASE				USERDATA_BASE	// the one user data page, kept by a main flash erase
+#define CONFIG_SPARE_BASE		(FLASH_LOG_BASE - FLASH_PAGE_SIZE)	// main flash page a rewrite is staged in
+#define CONFIG_MAGIC			0x43464731	// "CFG1", written last so an interrupted rewrite is ignored
+#define CONFIG_VERSION			1			// change when a key is added or its meaning changes
+#define CONFIG_ERASED			0xFFFFFFFF
+#define CONFIG_RECORDS			((FLASH_PAGE_SIZE - sizeof(CONFIG_HEADER)) / sizeof(CONFIG_RECORD))
+
+#define CONFIG_PERIOD_DEFAULT	3100		// ms, LETIMER PWM period
+#define CONFIG_PERIOD_MIN		100
+#define CONFIG_PERIOD_MAX		60000
+#define CONFIG_ACTIVE_DEFAULT	100			// ms, LETIMER PWM active time, shorter than the period
+#define CONFIG_ACTIVE_MIN		1
+#define CONFIG_BAUD_DEFAULT		9600		// LEUART and HM10 baud rate
+#define CONFIG_BAUD_MIN			1200
+#define CONFIG_BAUD_MAX			9600
+#define CONFIG_I2C_FREQ_DEFAULT	I2C_FREQ_FAST_MAX	// Hz, SI7021 bus
+#define CONFIG_I2C_FREQ_MIN		10000
+#define CONFIG_PERIOD_MESSAGE	"Period"	// "Period=3100" sets the sample period in ms
+#define CONFIG_ACTIVE_MESSAGE	"Active"	// "Active=100" sets the PWM active time in ms
+#define CONFIG_I2C_FREQ_MESSAGE	"I2cfreq"	// "I2cfreq=100000" sets the SI7021 bus from the next reset
+
+typedef enum {
+	CONFIG_PERIOD,
+	CONFIG_ACTIVE,
+	CONFIG_BAUD,
+	CONFIG_CELSIUS,
+	CONFIG_I2C_FREQ,
+	CONFIG_HM10_FAST,		// the HM10 may be at HM10_FAST_BAUDRATE, kept by the ble module
+	CONFIG_KEYS
+} CONFIG_KEY;
+
+typedef struct {
+	uint32_t	min;
+	uint32_t	max;
+	uint32_t	initial;		// used until the key is set, and after a version change
+} CONFIG_LIMIT;
+
+typedef struct {
+	uint32_t	magic;
+	uint32_t	version;
+} CONFIG_HEADER;
+
+typedef struct {
+	uint32_t	value;			// programmed first
+	uint32_t	key;			// programmed last, a record with an erased key is incomplete
+} CONFIG_RECORD;
+
+typedef void (*CONFIG_CHANGE_CB)(CONFIG_KEY key);
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void config_open(CONFIG_CHANGE_CB change);
+uint32_t config_get(CONFIG_KEY key);
+bool config_set(CONFIG_KEY key, uint32_t value);
+
+#endif /* SRC_HEADER_FILES_CONFIG_H_ */
@@ -0,0 +1,65 @@
+/*
+ * filter.h
+ *
+ *  Created on: May 24, 2020
+ *      Author: Justin Thwaites
+ */
+
+#ifndef SRC_HEADER_FILES_FILTER_H_
+#define SRC_HEADER_FILES_FILTER_H_
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include <stdbool.h>
+#include <stdint.h>
+#include "em_assert.h"
+#include "command.h"
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define FILTER_MAX_STAGES		3
+#define FILTER_MAX_WINDOW		9		// samples held by a moving average or median stage
+#define FILTER_IIR_SHIFT		8		// IIR coefficients are in 1/256 units
+#define FILTER_IIR_ONE			(1 << FILTER_IIR_SHIFT)
+#define FILTER_MESSAGE			"Filter"	// "Filter=M3,I64", an empty list turns filtering off
+#define FILTER_SEPARATOR		','
+#define FILTER_AVERAGE_CHAR		'A'		// "A4", moving average of 4 samples
+#define FILTER_MEDIAN_CHAR		'M'		// "M3", median of 3 samples
+#define FILTER_IIR_CHAR			'I'		// "I64", y += 64 / 256 * (x - y)
+#define FILTER_TEST_SAMPLES		8
+
+typedef enum {
+	FILTER_AVERAGE,
+	FILTER_MEDIAN,
+	FILTER_IIR
+} FILTER_TYPE;
+
+typedef struct {
+	FILTER_TYPE	type;
+	uint32_t	param;						// window for FILTER_AVERAGE and FILTER_MEDIAN, coefficient for FILTER_IIR
+	int32_t		history[FILTER_MAX_WINDOW];
+	uint32_t	count;						// samples held, up to the window
+	uint32_t	next;						// history index the next sample is written to
+	int32_t		sum;						// of the history, FILTER_AVERAGE
+	int32_t		state;						// output with FILTER_IIR_SHIFT fraction bits, FILTER_IIR
+} FILTER_STAGE;
+
+typedef struct {
+	FILTER_STAGE	stages[FILTER_MAX_STAGES];
+	uint32_t		stage_count;
+} FILTER;
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void filter_open(FILTER *filter);
+void filter_init(FILTER *filter);
+bool filter_add_stage(FILTER *filter, FILTER_TYPE type, uint32_t param);
+bool filter_configure(FILTER *filter, const char *spec);
+void filter_reset(FILTER *filter);
+int32_t filter_run(FILTER *filter, int32_t sample);
+void filter_test(void);
+
+#endif /* SRC_HEADER_FILES_FILTER_H_ */
@@ -0,0 +1,63 @@
+/*
+ * flash_log.h
+ *
+ *  Created on: May 27, 2020
+ *      Author: Justin Thwaites
+ */
+
+#ifndef SRC_HEADER_FILES_FLASH_LOG_H_
+#define SRC_HEADER_FILES_FLASH_LOG_H_
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include <stdbool.h>
+#include <stdint.h>
+#include "em_msc.h"
+#include "em_assert.h"
+#include "batch.h"
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define FLASH_LOG_PAGES			16		// 32 kB at the top of the main flash, kept out of FLASH in the .ld files, see config.h
+#define FLASH_LOG_BASE			(FLASH_BASE + FLASH_SIZE - FLASH_LOG_PAGES * FLASH_PAGE_SIZE)
+#define FLASH_LOG_MAGIC			0x4C4F4731	// "LOG1", written last so an interrupted page start is ignored
+#define FLASH_LOG_ERASED		0xFFFFFFFF
+#define FLASH_LOG_SENT			0x00000000	// written to the sent word once every record of a page is sent
+#define FLASH_LOG_RECORDS		((FLASH_PAGE_SIZE - sizeof(FLASH_LOG_HEADER)) / sizeof(FLASH_LOG_RECORD))
+#define FLASH_LOG_BUFFER		8		// samples held in RAM and programmed together
+
+typedef struct {
+	uint32_t	magic;
+	uint32_t	sequence;		// counts up with every page started, the highest is the newest
+	uint32_t	sent;
+	uint32_t	reserved;
+} FLASH_LOG_HEADER;
+
+typedef struct {
+	uint32_t	value;			// programmed first
+	uint32_t	time;			// programmed last, a record with an erased time is incomplete
+} FLASH_LOG_RECORD;
+
+typedef struct {
+	uint32_t	appended;		// samples handed to flash_log_append()
+	uint32_t	sent;			// samples read back and consumed
+	uint32_t	lost;			// unsent samples erased because the log was full
+	uint32_t	programs;		// buffer writes to flash
+	uint32_t	erases;			// pages erased
+} FLASH_LOG_STATS;
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void flash_log_open(void);
+void flash_log_append(const BATCH_SAMPLE *sample);
+void flash_log_sync(void);
+bool flash_log_pending(void);
+uint32_t flash_log_backlog(void);
+uint32_t flash_log_read(BATCH_SAMPLE *samples, uint32_t max);
+void flash_log_consume(uint32_t count);
+void flash_log_stats(FLASH_LOG_STATS *stats);
+
+#endif /* SRC_HEADER_FILES_FLASH_LOG_H_ */
@@ -0,0 +1,36 @@
+/*
+ * format.h
+ *
+ *  Created on: May 20, 2020
+ *      Author: Justin Thwaites
+ */
+
+#ifndef SRC_HEADER_FILES_FORMAT_H_
+#define SRC_HEADER_FILES_FORMAT_H_
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include <stdbool.h>
+#include <stdint.h>
+#include "em_assert.h"
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define FORMAT_UINT_MAX_LEN		10		// digits of 4294967295
+#define FORMAT_INT_MAX_LEN		11		// sign and digits of -2147483648
+#define FORMAT_MAX_DECIMALS		4
+#define FORMAT_TEST_SIZE		16
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+uint32_t format_str(char *buf, const char *str);
+uint32_t format_uint(char *buf, uint32_t value);
+uint32_t format_int(char *buf, int32_t value);
+uint32_t format_fixed(char *buf, int32_t value, uint32_t decimals, uint32_t width);
+int32_t format_round_div(int32_t value, int32_t divisor);
+void format_test(void);
+
+#endif /* SRC_HEADER_FILES_FORMAT_H_ */
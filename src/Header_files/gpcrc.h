@@ -0,0 +1,20 @@
+#ifndef GPCRC_H
+#define	GPCRC_H
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include <stdint.h>
+#include "em_gpcrc.h"
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define CRC16_POLY			0x1021		// CRC-16/CCITT-FALSE
+#define CRC16_INIT			0xFFFF
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void gpcrc_open(void);
+uint16_t gpcrc_crc16(const uint8_t *data, uint32_t len);
+#endif
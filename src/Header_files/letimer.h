@@ -4,13 +4,33 @@
 // Include files
 //***********************************************************************************
 #include "em_letimer.h"
+#include "em_cmu.h"
 #include "sleep_routines.h"
 #include "scheduler.h"
 
 //***********************************************************************************
 // defined files
 //***********************************************************************************
-#define LETIMER_HZ		1000			// Utilizing ULFRCO oscillator for LETIMERs
+#define LETIMER_NOMINAL_HZ	1000			// ULFRCO on the LFA branch, see cmu_open(), assumed by the compile-time checks
+#define LETIMER_MAX_TICKS	65536			// 16 bit COMP0, a period is COMP0 + 1 ticks
+#define LETIMER_MIN_TICKS	2
+#define LETIMER_MAX_PRESCALER	32768		// largest LFA prescaler of an LETIMER
+#define LETIMER_MS_PER_S	1000
+#if defined(LETIMER1)
+#define LETIMER_INSTANCES	2
+#else
+#define LETIMER_INSTANCES	1				// the EFM32PG12 has LETIMER0 only
+#endif
+#define LETIMER_US_PER_S	1000000
+#define LETIMER_NS_PER_S	1000000000
+#define LETIMER_NS_PER_US	1000
+
+// Ticks of a time in us at an LFA clock and prescaler, rounded to the nearest tick
+#define LETIMER_US_TO_TICKS(us, hz, div)	((((uint64_t)(us)) * (hz) + (uint64_t)(div) * LETIMER_US_PER_S / 2) / ((uint64_t)(div) * LETIMER_US_PER_S))
+
+// True if a constant period can be counted at the clock with some prescaler, for _Static_assert
+#define LETIMER_PERIOD_FITS(us, hz)	(LETIMER_US_TO_TICKS(us, hz, 1) >= LETIMER_MIN_TICKS \
+		&& LETIMER_US_TO_TICKS(us, hz, LETIMER_MAX_PRESCALER) <= LETIMER_MAX_TICKS)
 #define LETIMER_EM EM4 // Using the ULFRCO, block from entering Energy Mode 4
 #define DISABLE_LETIMER false
 #define ENABLE_LETIMER true
@@ -25,8 +45,9 @@ typedef struct {
 	uint8_t			out_pin_route1;		// out 1 route to gpio port/pin
 	bool			out_pin_0_en;		// enable out 0 route
 	bool			out_pin_1_en;		// enable out 1 route
-	float			period;				// seconds
-	float			active_period;		// seconds
+	uint32_t		period;				// us
+	uint32_t		active_period;		// us
+	uint32_t		max_period;			// us, longest period letimer_set_period() may set, selects the prescaler
 	bool			comp0_irq_enable; // enable interrupt on comp0 interrupt
 	uint32_t		comp0_evt;
 	bool			comp1_irq_enable; // enable interrupt on comp1 interrupt
@@ -37,6 +58,28 @@ typedef struct {
 
 } APP_LETIMER_PWM_TypeDef ;
 
+// Driver state of one LETIMER instance, so each instance runs its own schedule
+typedef struct {
+	CMU_Clock_TypeDef	clock;
+	IRQn_Type			irq;
+	uint32_t			comp0_evt;			// scheduler events of this instance
+	uint32_t			comp1_evt;
+	uint32_t			uf_evt;
+	uint32_t			lfa_hz;				// LFA branch clock, read from the CMU when opened
+	uint32_t			prescaler;			// LFA clocks per LETIMER tick, a power of two
+	volatile uint32_t	ms_base;			// ms at the start of the current period, the upper part of letimer_ms()
+	volatile uint32_t	ms_frac;			// fraction of a ms in ms_base, in 1 / lfa_hz ms
+	uint32_t			requested_period;	// us asked for by the last open or letimer_set_period()
+	uint32_t			requested_ticks;	// ticks that period was rounded to
+	volatile uint32_t	period_top;			// COMP0 the current period was loaded with
+	uint32_t			reload_top;			// COMP0 the next period is loaded with
+	uint32_t			staged_top;			// period requested by letimer_set_period()
+	uint32_t			staged_active;
+	volatile bool		staged;				// a requested period waits for the next underflow
+	uint32_t			comp1_next;			// active time of the period starting at the next underflow
+	bool				comp1_pending;
+} LETIMER_CONTEXT;
+
 
 //***********************************************************************************
 // function prototypes
@@ -44,5 +87,11 @@ typedef struct {
 void letimer_pwm_open(LETIMER_TypeDef *letimer, APP_LETIMER_PWM_TypeDef *app_letimer_struct);
 void letimer_start(LETIMER_TypeDef *letimer, bool enable);
 void LETIMER0_IRQHandler(void);
+#if defined(LETIMER1)
+void LETIMER1_IRQHandler(void);
+#endif
+uint32_t letimer_ms(LETIMER_TypeDef *letimer);
+bool letimer_set_period(LETIMER_TypeDef *letimer, uint32_t period, uint32_t active_period);
+int32_t letimer_period_error(LETIMER_TypeDef *letimer);
 
 #endif
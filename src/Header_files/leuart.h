@@ -9,6 +9,8 @@
 #include "sleep_routines.h"
 #include "scheduler.h"
 #include "HW_delay.h"
+#include "spsc_ring.h"
+#include "tx_segment.h"
 
 //***********************************************************************************
 // defined files
@@ -18,6 +20,10 @@
 #define LEUART_RX_EM		EM3
 #define RX_STARTFRAME       '>'
 #define RX_SIGFRAME      	';'
+#define LEUART_RX_DELIMITER	0x00		// end of a binary (COBS) frame
+#define LEUART_MSG_SIZE		80
+#define LEUART_RX_QUEUE_SIZE	256		// power of two, holds several received messages
+#define LEUART_RX_WATCHES	2		// patterns matched in the raw received stream
 /***************************************************************************//**
  * @addtogroup leuart
  * @{}
@@ -60,8 +66,11 @@ typedef enum{
 
 typedef struct {
 	uint32_t	message_len;
-	char		message[80];
-	char		rx_message[80];
+	const char	*message;		// current segment, must stay valid until the transmission is done
+	TX_SEGMENT	segments[TX_MAX_SEGMENTS];
+	uint32_t	segment_count;
+	uint32_t	segment;
+	char		rx_message[LEUART_MSG_SIZE];
 	LEUART_RXStates rx_state;
 	uint32_t	index;
 	uint32_t	rx_index;
@@ -71,6 +80,12 @@ typedef struct {
 	uint32_t       event;
 	volatile bool 	txbusy;
 	volatile bool 	rxbusy;
+	bool			rx_delimited;
+	bool			rx_raw;			// every byte is queued as it arrives
+	const char		*watch[LEUART_RX_WATCHES];
+	uint32_t		watch_match[LEUART_RX_WATCHES];	// characters of each pattern matched so far
+	uint32_t		watch_count;
+	uint32_t		rx_dropped;		// messages lost to a full RX queue
 }LEUART_PAYLOAD;
 
 
@@ -88,7 +103,10 @@ typedef struct {
 void leuart_open(LEUART_TypeDef *leuart, LEUART_OPEN_STRUCT *leuart_settings);
 void LEUART0_IRQHandler(void);
 void leuart_start(LEUART_TypeDef *leuart, char *string, uint32_t string_len);
+void leuart_start_segments(LEUART_TypeDef *leuart, const TX_SEGMENT *segments, uint32_t count);
 bool leuart_tx_busy(LEUART_TypeDef *leuart);
+void leuart_route(LEUART_TypeDef *leuart, bool enable);
+void leuart_set_baud(LEUART_TypeDef *leuart, uint32_t ref_freq, uint32_t baudrate);
 
 uint32_t leuart_status(LEUART_TypeDef *leuart);
 void leuart_cmd_write(LEUART_TypeDef *leuart, uint32_t cmd_update);
@@ -101,6 +119,9 @@ void leuart_sigf();
 void leuart_startf();
 void leuart_rxsetup(LEUART_TypeDef *leuart);
 void leuart_rxtest(LEUART_TypeDef *leuart);
-char* leuart_rxmessage(void);
+bool leuart_rx_read(char *message);
+void leuart_rx_delimited(LEUART_TypeDef *leuart, bool enable);
+void leuart_rx_raw(LEUART_TypeDef *leuart, bool enable);
+void leuart_rx_watch(LEUART_TypeDef *leuart, const char *pattern);
 
 #endif
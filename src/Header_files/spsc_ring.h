@@ -0,0 +1,52 @@
+#ifndef SPSC_RING_H
+#define	SPSC_RING_H
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include <stdint.h>
+#include <stdbool.h>
+#include "em_device.h"
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define SPSC_RECORD_HEADER	2			// records are stored behind a 16 bit header
+#define SPSC_RECORD_ALIGN	2			// records start on a header boundary
+#define SPSC_RECORD_LEN		0x0FFF		// header bits 0-11, length of the record
+#define SPSC_RECORD_FLAGS	0x7000		// header bits 12-14, free for the user of the ring
+#define SPSC_RECORD_FLAG_SHIFT	12
+#define SPSC_RECORD_PAD		0x8000		// header bit 15, filler in front of a record that wrapped
+#define SPSC_RECORD_MAX		SPSC_RECORD_LEN
+#define SPSC_BARRIER()		__DMB()
+
+/***************************************************************************//**
+ * @addtogroup spsc_ring
+ * @{
+ ******************************************************************************/
+
+typedef struct {
+	uint8_t				*buf;
+	uint32_t			mask;
+	volatile uint32_t	head;		// free running, only written by the producer
+	volatile uint32_t	tail;		// free running, only written by the consumer
+	uint32_t			pad;		// producer only, filler in front of the reserved record
+	uint32_t			reserved;	// producer only, length of the reserved record
+} SPSC_RING;
+
+/** @} (end addtogroup spsc_ring) */
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void spsc_ring_init(SPSC_RING *ring, uint8_t *storage, uint32_t size);
+uint32_t spsc_ring_count(SPSC_RING *ring);
+uint32_t spsc_ring_space(SPSC_RING *ring);
+void *spsc_ring_reserve(SPSC_RING *ring, uint32_t len);
+void spsc_ring_commit(SPSC_RING *ring, uint32_t len, uint32_t flags);
+void *spsc_ring_peek_record(SPSC_RING *ring, uint32_t *len, uint32_t *flags);
+void *spsc_ring_peek_next(SPSC_RING *ring, uint32_t *offset, uint32_t *len, uint32_t *flags);
+void spsc_ring_consume_record(SPSC_RING *ring);
+bool spsc_ring_write_record(SPSC_RING *ring, const void *data, uint32_t len);
+bool spsc_ring_read_record(SPSC_RING *ring, void *data, uint32_t max, uint32_t *len);
+
+#endif
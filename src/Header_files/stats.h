@@ -0,0 +1,50 @@
+/*
+ * stats.h
+ *
+ *  Created on: May 25, 2020
+ *      Author: Justin Thwaites
+ */
+
+#ifndef SRC_HEADER_FILES_STATS_H_
+#define SRC_HEADER_FILES_STATS_H_
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "em_assert.h"
+#include "command.h"
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define STATS_FRAC_BITS			8		// fraction bits of the running mean
+#define STATS_ONE				(1 << STATS_FRAC_BITS)
+#define STATS_DEFAULT_WINDOW	100		// samples, about 5 minutes at 3.1 s
+#define STATS_MAX_WINDOW		10000
+#define STATS_WINDOW_MESSAGE	"Window"	// "Window=100" sends a summary every 100 samples, 0 turns them off
+#define STATS_TEST_SAMPLES		8
+
+typedef struct {
+	uint32_t	count;
+	int32_t		min;
+	int32_t		max;
+	int32_t		mean;		// rounded to the units of the samples
+	int32_t		stddev;		// sample standard deviation, rounded to the units of the samples
+} STATS_SUMMARY;
+
+typedef void (*STATS_CB)(const STATS_SUMMARY *summary);
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void stats_open(STATS_CB summary_cb);
+void stats_add(int32_t value);
+void stats_summary(STATS_SUMMARY *summary);
+void stats_reset(void);
+bool stats_set_window(uint32_t samples);
+void stats_test(void);
+
+#endif /* SRC_HEADER_FILES_STATS_H_ */
@@ -0,0 +1,23 @@
+#ifndef TX_SEGMENT_H
+#define	TX_SEGMENT_H
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include <stdint.h>
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define TX_MAX_SEGMENTS		8		// messages the UART drivers can send as one transfer
+
+/***************************************************************************//**
+ * @brief
+ *	One block of a transfer.  The UART drivers send the blocks of a transfer back to back
+ *	and signal a single tx done event at the end.
+ ******************************************************************************/
+typedef struct {
+	const char	*data;
+	uint32_t	len;
+} TX_SEGMENT;
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef USART_H
+#define	USART_H
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+
+#include "em_usart.h"
+#include "sleep_routines.h"
+#include "scheduler.h"
+#include "spsc_ring.h"
+#include "tx_segment.h"
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+
+#define USART_TX_EM			EM2		// USART runs from HFPERCLK, it can not operate below EM1
+#define USART_RX_EM			EM2
+#define USART_RX_STARTFRAME	'>'
+#define USART_RX_SIGFRAME	';'
+#define USART_RX_DELIMITER	0x00		// end of a binary (COBS) frame
+#define USART_MSG_SIZE		80
+#define USART_RX_QUEUE_SIZE	256		// power of two, holds several received messages
+#define USART_RX_WATCHES	2		// patterns matched in the raw received stream
+/***************************************************************************//**
+ * @addtogroup usart
+ * @{}
+ ******************************************************************************/
+
+typedef struct {
+	uint32_t							baudrate;
+	USART_Databits_TypeDef				databits;
+	USART_Enable_TypeDef				enable;
+	USART_Parity_TypeDef 				parity;
+	USART_Stopbits_TypeDef				stopbits;
+	uint32_t							ref_freq;
+	uint32_t							rx_loc;
+	bool								rx_pin_en;
+	uint32_t							tx_loc;
+	bool								tx_pin_en;
+	uint32_t							rx_done_evt;
+	uint32_t							tx_done_evt;
+} USART_OPEN_STRUCT;
+
+typedef enum{
+	USART_INITIALIZE,
+	USART_SEND_DATA,
+	USART_FINISH_WAIT
+} USART_States;
+
+typedef enum{
+	USART_RX_WAIT,
+	USART_RX_RECEIVE
+} USART_RXStates;
+
+typedef struct {
+	uint32_t		message_len;
+	const char		*message;		// current segment, must stay valid until the transmission is done
+	TX_SEGMENT		segments[TX_MAX_SEGMENTS];
+	uint32_t		segment_count;
+	uint32_t		segment;
+	char			rx_message[USART_MSG_SIZE];
+	USART_RXStates	rx_state;
+	uint32_t		index;
+	uint32_t		rx_index;
+	USART_States	state;
+	USART_TypeDef	*usart;
+	bool			open;
+	bool			rx_delimited;
+	bool			rx_raw;			// every byte is queued as it arrives
+	const char		*watch[USART_RX_WATCHES];
+	uint32_t		watch_match[USART_RX_WATCHES];	// characters of each pattern matched so far
+	uint32_t		watch_count;
+	volatile bool	txbusy;
+	volatile bool	rxbusy;
+	uint32_t		rx_dropped;		// messages lost to a full RX queue
+}USART_PAYLOAD;
+
+
+
+/** @} (end addtogroup usart) */
+
+//***********************************************************************************
+// global variables
+//***********************************************************************************
+
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void usart_open(USART_TypeDef *usart, USART_OPEN_STRUCT *usart_settings);
+void usart_close(USART_TypeDef *usart);
+void usart_start(USART_TypeDef *usart, char *string, uint32_t string_len);
+void usart_start_segments(USART_TypeDef *usart, const TX_SEGMENT *segments, uint32_t count);
+bool usart_tx_busy(USART_TypeDef *usart);
+bool usart_rx_read(char *message);
+void usart_rx_delimited(USART_TypeDef *usart, bool enable);
+void usart_rx_raw(USART_TypeDef *usart, bool enable);
+void usart_rx_watch(USART_TypeDef *usart, const char *pattern);
+void USART0_RX_IRQHandler(void);
+void USART0_TX_IRQHandler(void);
+
+#endif
@@ -10,6 +10,10 @@
 // Include files
 //***********************************************************************************
 #include "SI7021.h"
+#ifdef SI7021_TEST_ENABLED
+#include <math.h>
+#include "bench.h"
+#endif
 
 
 static uint32_t si7021_data;
@@ -45,7 +49,7 @@ void si7021_i2c_open(uint32_t evt){
 	i2c_open_values.SDA_RouteLoc0 = SI7021_SDA_LOC;
 	i2c_open_values.clhr = SI7021_I2C_CLK_RATIO;
 	i2c_open_values.enable = true;
-	i2c_open_values.freq = SI7021_I2C_FREQ;
+	i2c_open_values.freq = config_get(CONFIG_I2C_FREQ);	// Hz, applied when the bus is opened
 	i2c_open_values.master = true;
 	i2c_open_values.refFreq = SI7021_REFFREQ;
 
@@ -57,20 +61,92 @@ void si7021_i2c_open(uint32_t evt){
 
 /***************************************************************************//**
  * @brief
- * Returns the temperature data from the private variable stored in si7021 in Fahrenheit
+ * Converts a temperature code from the SI7021 to hundredths of a degree Celsius.
  *
  * @details
- *	Uses the documentation from the SI7021 to read the temperature into a Celsius float, and then returns this value as a Fahrenheit float value
+ *	Integer form of the datasheet formula 175.72 * code / 65536 - 46.85, rounded to nearest.
+ *	The product fits in 32 bits for every 16 bit code.
+ *
+ * @param[in] code
+ *	The 16 bit temperature code.
+ ******************************************************************************/
+int32_t si7021_code_centi_c(uint32_t code){
+	return (int32_t)((SI7021_CENTI_C_MUL * code + (1 << (SI7021_CODE_SHIFT - 1))) >> SI7021_CODE_SHIFT)
+			- SI7021_CENTI_C_OFFSET;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Converts a temperature code from the SI7021 to hundredths of a degree Fahrenheit.
+ *
+ * @details
+ *	The Celsius formula and 9 / 5 * C + 32 are folded into one fraction, so the result is the
+ *	exact Fahrenheit value rounded to nearest and not the rounded Celsius value converted again.
+ *
+ * @param[in] code
+ *	The 16 bit temperature code.
+ ******************************************************************************/
+int32_t si7021_code_centi_f(uint32_t code){
+	return (int32_t)((SI7021_CENTI_F_MUL * code + SI7021_CENTI_F_DIV / 2) / SI7021_CENTI_F_DIV)
+			- SI7021_CENTI_F_OFFSET;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Converts a humidity code from the SI7021 to hundredths of a percent relative humidity.
+ *
+ * @details
+ *	Integer form of the datasheet formula 125 * code / 65536 - 6, rounded to nearest.
+ *
+ * @note
+ *	The datasheet formula can give values slightly below 0 or above 100 %, which are not clamped.
+ *
+ * @param[in] code
+ *	The 16 bit humidity code.
+ ******************************************************************************/
+int32_t si7021_code_centi_rh(uint32_t code){
+	return (int32_t)((SI7021_CENTI_RH_MUL * code + (1 << (SI7021_CODE_SHIFT - 1))) >> SI7021_CODE_SHIFT)
+			- SI7021_CENTI_RH_OFFSET;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns the raw temperature code from the private variable stored in si7021
+ *
+ * @details
+ * The code is converted with si7021_code_centi_c() or si7021_code_centi_f(), so a reading stored for
+ * later can still be reported in either unit.
+ *
+ * @note
+ *	This call must happen after the I2C communication from the sensor has already received the data and put it in the private variable.
+ *
+ ******************************************************************************/
+uint32_t si7021_temp_code(void){
+	return si7021_data;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns the temperature data from the private variable stored in si7021 in hundredths of a degree Celsius
  *
  * @note
  *	This call must happen after the I2C communication from the sensor has already received the data and put it in the private variable.
  *
  ******************************************************************************/
+int32_t si7021_temp_centi_c(void){
+	return si7021_code_centi_c(si7021_data);
+}
 
-float si7021_i2c_data(){
-float Celsius;
-Celsius = (175.72 * si7021_data)/65536.0 - 46.85;
-return (9.0/5.0)*Celsius + 32;
+/***************************************************************************//**
+ * @brief
+ * Returns the temperature data from the private variable stored in si7021 in hundredths of a degree Fahrenheit
+ *
+ * @note
+ *	This call must happen after the I2C communication from the sensor has already received the data and put it in the private variable.
+ *
+ ******************************************************************************/
+int32_t si7021_temp_centi_f(void){
+	return si7021_code_centi_f(si7021_data);
 }
 
 /***************************************************************************//**
@@ -96,3 +172,52 @@ void si7021_read_temp(){
 	i2c_start(&temp_read);
 }
 
+#ifdef SI7021_TEST_ENABLED
+/***************************************************************************//**
+ * @brief
+ *	Checks the integer conversions against the datasheet formulas for every 16 bit code and
+ *	measures the cycles per sample against the former float conversion.
+ *
+ * @details
+ *	The reference is computed in double precision as floor(value + 0.5).  The products are
+ *	integers below 2^53 and the divisions are far from a rounding boundary unless the exact
+ *	value is a half, which a double holds exactly, so the reference is the exact rounded value.
+ *
+ * @note
+ *	This function is a test and should only be called once.  It takes a few seconds because of
+ *	the software double math of the reference.
+ *
+ * @param[out] *result
+ *	The cycles per sample of both conversions.
+ ******************************************************************************/
+void si7021_conversion_test(SI7021_TEST_RESULT *result){
+	volatile float sink_float;
+	volatile int32_t sink_int;
+	uint32_t start;
+	float celsius;
+
+	for(uint32_t code = 0; code < SI7021_CODES; code++){
+		EFM_ASSERT(si7021_code_centi_c(code)
+				== (int32_t)floor(SI7021_CENTI_C_MUL * (double)code / SI7021_CODES + 0.5) - SI7021_CENTI_C_OFFSET);
+		EFM_ASSERT(si7021_code_centi_f(code)
+				== (int32_t)floor(9.0 * SI7021_CENTI_C_MUL * code / (5.0 * SI7021_CODES) + 0.5) - SI7021_CENTI_F_OFFSET);
+		EFM_ASSERT(si7021_code_centi_rh(code)
+				== (int32_t)floor(SI7021_CENTI_RH_MUL * (double)code / SI7021_CODES + 0.5) - SI7021_CENTI_RH_OFFSET);
+	}
+
+	bench_open();
+	start = bench_cycles();
+	for(uint32_t code = 0; code < SI7021_CODES; code++){
+		celsius = (175.72 * code)/65536.0 - 46.85;
+		sink_float = (9.0/5.0)*celsius + 32;
+	}
+	result->float_cycles = (bench_cycles() - start) / SI7021_CODES;
+	start = bench_cycles();
+	for(uint32_t code = 0; code < SI7021_CODES; code++){
+		sink_int = si7021_code_centi_f(code);
+	}
+	result->int_cycles = (bench_cycles() - start) / SI7021_CODES;
+	(void)sink_float;
+	(void)sink_int;
+}
+#endif
@@ -0,0 +1,430 @@
+/**
+ * @file adapt.c
+ * @author Justin Thwaites
+ * @date 5/30/2020
+ * @brief Chooses the sample period from how fast the temperature is changing
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include "adapt.h"
+#include "ble.h"
+#include "format.h"
+
+//***********************************************************************************
+// private variables
+//***********************************************************************************
+static ADAPT_APPLY_CB apply_cb;
+static bool enabled;
+static uint32_t base_period;		// ms, used while the controller is off
+static uint32_t period;				// ms, the period in use
+static uint32_t min_period;
+static uint32_t max_period;
+static uint32_t budget;				// ms, the average period the energy allows
+static int32_t credit;				// ms of budget saved, spent by periods shorter than the budget
+static int32_t slope;				// hundredths of a degree per minute, averaged
+static uint32_t quiet;				// samples in a row with a flat slope
+static bool have_last;
+static uint32_t last_time;
+static uint32_t anchor_time;		// reading the slope is measured from
+static int32_t anchor_value;
+static ADAPT_STATS stats;
+
+/***************************************************************************//**
+ * @brief Adapt module
+ * @details
+ *  The slope of the temperature, averaged over a few spans, sets the sample
+ *  period.  A slope of ADAPT_FAST_SLOPE or more halves the period, down to the
+ *  minimum, so a transient is followed closely.  ADAPT_SETTLE flat spans in a
+ *  row double it, up to the maximum, so a steady temperature costs few
+ *  conversions and transmissions.
+ *
+ *  The energy budget is an average period.  Every sample earns the time since
+ *  the last one and pays the budget, so the credit grows while the period is
+ *  longer than the budget and shrinks while it is shorter.  The period is only
+ *  halved while there is credit, and once the credit is spent it is doubled
+ *  until the period is back at the budget, so over time the controller samples
+ *  no more often than fixed sampling at the budget period.  The credit is held
+ *  below ADAPT_CREDIT_MAX so a long quiet spell cannot pay for an unlimited burst.
+ *
+ *  The module only decides.  The apply callback reprograms the timer and may
+ *  refuse a period, and every decision is counted.
+ *
+ ******************************************************************************/
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *	Moves to a new period through the apply callback and counts the decision.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ ******************************************************************************/
+static void adapt_change(uint32_t new_period, uint32_t *counter){
+	if(new_period == period) return;
+	if(!apply_cb(new_period, slope)){
+		stats.rejected++;
+		return;
+	}
+	period = new_period;
+	if(counter != NULL) (*counter)++;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Restarts the slope, the quiet count and the credit.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ ******************************************************************************/
+static void adapt_restart(void){
+	slope = 0;
+	quiet = 0;
+	credit = 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Sets every setting and counter to its default, with the controller off.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ ******************************************************************************/
+static void adapt_defaults(void){
+	enabled = false;
+	period = base_period;
+	min_period = ADAPT_DEFAULT_MIN;
+	max_period = ADAPT_DEFAULT_MAX;
+	budget = ADAPT_DEFAULT_BUDGET;
+	stats.faster = 0;
+	stats.slower = 0;
+	stats.budget = 0;
+	stats.rejected = 0;
+	have_last = false;
+	adapt_restart();
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Adds the time since the last reading to the credit and pays the budget for the reading.
+ *
+ * @details
+ *	Once the credit is spent the period is doubled until it is back at the budget, whatever
+ *	the slope.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ ******************************************************************************/
+static void adapt_spend(uint32_t elapsed){
+	credit += (int32_t)elapsed - (int32_t)budget;
+	if(credit > ADAPT_CREDIT_MAX) credit = ADAPT_CREDIT_MAX;
+	if(credit < -ADAPT_CREDIT_MAX) credit = -ADAPT_CREDIT_MAX;
+	if(credit < 0 && period < budget){
+		quiet = 0;
+		adapt_change(period * 2 < max_period ? period * 2 : max_period, &stats.budget);
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ * Command handlers for the controller settings and counters.
+ *
+ * @note
+ *	These functions are private and are called through the command table.
+ ******************************************************************************/
+static CMD_STATUS adapt_cmd_enable(CMD_ARG *arg){
+	return adapt_set_enable(arg->value) ? CMD_OK : CMD_ERROR;
+}
+
+static CMD_STATUS adapt_cmd_min(CMD_ARG *arg){
+	return adapt_set_limits(arg->value, max_period) ? CMD_OK : CMD_BAD_ARG;
+}
+
+static CMD_STATUS adapt_cmd_max(CMD_ARG *arg){
+	return adapt_set_limits(min_period, arg->value) ? CMD_OK : CMD_BAD_ARG;
+}
+
+static CMD_STATUS adapt_cmd_budget(CMD_ARG *arg){
+	return adapt_set_budget(arg->value) ? CMD_OK : CMD_BAD_ARG;
+}
+
+static CMD_STATUS adapt_cmd_stats(CMD_ARG *arg){
+	char reply[ADAPT_STATS_SIZE];
+	uint32_t len;
+
+	len = format_str(reply, "period ");
+	len += format_uint(reply + len, period);
+	len += format_str(reply + len, " faster ");
+	len += format_uint(reply + len, stats.faster);
+	len += format_str(reply + len, " slower ");
+	len += format_uint(reply + len, stats.slower);
+	len += format_str(reply + len, " budget ");
+	len += format_uint(reply + len, stats.budget);
+	format_str(reply + len, "\n");
+	ble_reply(reply);
+	return CMD_OK;
+}
+
+static const CMD_ENTRY adapt_commands[] = {
+	{ ADAPT_ENABLE_MESSAGE,	CMD_ARG_INT,  0, 1, adapt_cmd_enable },
+	{ ADAPT_MIN_MESSAGE,	CMD_ARG_INT,  ADAPT_MIN_LIMIT, ADAPT_MAX_LIMIT, adapt_cmd_min },
+	{ ADAPT_MAX_MESSAGE,	CMD_ARG_INT,  ADAPT_MIN_LIMIT, ADAPT_MAX_LIMIT, adapt_cmd_max },
+	{ ADAPT_BUDGET_MESSAGE,	CMD_ARG_INT,  ADAPT_MIN_LIMIT, ADAPT_MAX_LIMIT, adapt_cmd_budget },
+	{ ADAPT_STATS_MESSAGE,	CMD_ARG_NONE, 0, 0, adapt_cmd_stats },
+};
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *	Sets up the controller, off, and registers its commands.
+ *
+ * @note
+ *	This function should only be called once in setup of the device, after command_open().
+ *
+ * @param[in] apply
+ *	Called with a new period in ms and the slope that chose it.  Returns false if the
+ *	period cannot be used, and the controller keeps the current one.
+ *
+ * @param[in] base_period_ms
+ *	The period in ms in use now, kept while the controller is off.
+ ******************************************************************************/
+void adapt_open(ADAPT_APPLY_CB apply, uint32_t base_period_ms){
+	EFM_ASSERT(apply != NULL);
+	apply_cb = apply;
+	base_period = base_period_ms;
+	adapt_defaults();
+	for(int i = 0; i < sizeof(adapt_commands) / sizeof(adapt_commands[0]); i++){
+		command_register(&adapt_commands[i]);
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Updates the slope and the credit with a reading and changes the period if needed.
+ *
+ * @details
+ *	The credit is updated on every reading, and a spent budget lengthens the period even
+ *	while the temperature is changing.  The slope is measured from an anchor reading at
+ *	least ADAPT_SPAN ms old, less ADAPT_NOISE, so the sensor noise between two short
+ *	periods does not look like a transient.  A single span at the fast slope is enough to
+ *	halve the period, while doubling it takes the averaged slope staying flat.
+ *
+ * @note
+ *	Called once per sensor period.  Readings are followed while the controller is off so
+ *	it starts from the last reading.
+ *
+ * @param[in] time
+ *	ms when the reading was taken.
+ *
+ * @param[in] value
+ *	The reading, in hundredths of a degree.
+ ******************************************************************************/
+void adapt_sample(uint32_t time, int32_t value){
+	uint32_t elapsed = time - last_time;
+	uint32_t span = time - anchor_time;
+	uint32_t moved = value > anchor_value ? value - anchor_value : anchor_value - value;
+	int32_t span_slope;
+
+	if(!have_last || elapsed == 0){
+		have_last = true;
+		last_time = time;
+		anchor_time = time;
+		anchor_value = value;
+		return;
+	}
+	last_time = time;
+	if(!enabled || span < ADAPT_SPAN){
+		if(!enabled){
+			anchor_time = time;
+			anchor_value = value;
+		}
+		else{
+			adapt_spend(elapsed);
+		}
+		return;
+	}
+	anchor_time = time;
+	anchor_value = value;
+	adapt_spend(elapsed);
+
+	moved = moved > ADAPT_NOISE ? moved - ADAPT_NOISE : 0;
+	span_slope = (uint64_t)moved * ADAPT_MS_PER_MIN / span;
+	slope += (span_slope - slope) / (1 << ADAPT_SLOPE_WEIGHT);
+
+	if(span_slope >= ADAPT_FAST_SLOPE || slope >= ADAPT_FAST_SLOPE){
+		quiet = 0;
+		if(credit > 0){
+			adapt_change(period / 2 > min_period ? period / 2 : min_period, &stats.faster);
+		}
+	}
+	else if(slope < ADAPT_SLOW_SLOPE && ++quiet >= ADAPT_SETTLE){
+		quiet = 0;
+		adapt_change(period * 2 < max_period ? period * 2 : max_period, &stats.slower);
+	}
+	else if(slope >= ADAPT_SLOW_SLOPE){
+		quiet = 0;
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Sets the period used while the controller is off.
+ *
+ * @details
+ *	While the controller is off the period is applied straight away.  While it is on, the
+ *	controller returns to this period when it is turned off.
+ *
+ * @param[in] period_ms
+ *	The period in ms.
+ ******************************************************************************/
+void adapt_set_base(uint32_t period_ms){
+	base_period = period_ms;
+	if(!enabled){
+		adapt_change(base_period, NULL);
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Turns the controller on or off.
+ *
+ * @details
+ *	The controller starts from the period in use with a clear slope and no credit.  Turning
+ *	it off returns to the base period.
+ *
+ * @return
+ *	false if the base period could not be applied when turning off.
+ ******************************************************************************/
+bool adapt_set_enable(bool enable){
+	if(enable == enabled) return true;
+	enabled = enable;
+	adapt_restart();
+	if(!enabled){
+		adapt_change(base_period, NULL);
+		return period == base_period;
+	}
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Sets the shortest and longest period the controller may choose.
+ *
+ * @details
+ *	A period in use outside the new limits is moved inside them on the next reading.
+ *
+ * @param[in] min
+ *	ms, at least ADAPT_MIN_LIMIT.
+ *
+ * @param[in] max
+ *	ms, at least min and at most ADAPT_MAX_LIMIT.
+ *
+ * @return
+ *	false if the limits are out of range.
+ ******************************************************************************/
+bool adapt_set_limits(uint32_t min, uint32_t max){
+	if(min < ADAPT_MIN_LIMIT || max > ADAPT_MAX_LIMIT || min > max) return false;
+	min_period = min;
+	max_period = max;
+	if(enabled && period < min_period) adapt_change(min_period, NULL);
+	if(enabled && period > max_period) adapt_change(max_period, NULL);
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Sets the average period the energy budget allows.
+ *
+ * @param[in] period_ms
+ *	ms, ADAPT_MIN_LIMIT to ADAPT_MAX_LIMIT.
+ *
+ * @return
+ *	false if the budget is out of range.
+ ******************************************************************************/
+bool adapt_set_budget(uint32_t period_ms){
+	if(period_ms < ADAPT_MIN_LIMIT || period_ms > ADAPT_MAX_LIMIT) return false;
+	budget = period_ms;
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Returns the period in ms in use.
+ ******************************************************************************/
+uint32_t adapt_period(void){
+	return period;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Copies the decision counters.
+ ******************************************************************************/
+void adapt_stats(ADAPT_STATS *copy){
+	*copy = stats;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Accepts every period, for adapt_test().
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ ******************************************************************************/
+static bool adapt_test_apply(uint32_t new_period, uint32_t new_slope){
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	This function tests the controller against a flat, a ramping and a long ramping trace.
+ *
+ * @details
+ *	A flat trace doubles the period every ADAPT_SETTLE spans up to the maximum.  A ramp of
+ *	1 F per minute halves it once per span while the credit saved by the flat samples lasts,
+ *	and a ramp that outlasts the credit is held at the budget period.
+ *	The apply callback is swapped for the test and every setting is restored after.
+ *
+ * @note
+ *	This function is a test and should only be called once, before any setting is changed.
+ ******************************************************************************/
+void adapt_test(void){
+	ADAPT_APPLY_CB saved_cb = apply_cb;
+	uint32_t time = 0;
+	int32_t value = 7000;
+
+	apply_cb = adapt_test_apply;
+	adapt_defaults();
+	EFM_ASSERT(adapt_set_enable(true));
+
+	for(uint32_t i = 0; i < ADAPT_TEST_SAMPLES; i++){
+		adapt_sample(time, value);
+		time += period;
+	}
+	EFM_ASSERT(period == ADAPT_DEFAULT_MAX && stats.slower == 2 && stats.faster == 0);
+	EFM_ASSERT(credit == ADAPT_CREDIT_MAX);
+
+	for(uint32_t i = 0; i < 4; i++){
+		value += period * 100 / ADAPT_MS_PER_MIN;		// 1 F per minute
+		adapt_sample(time, value);
+		time += period;
+	}
+	EFM_ASSERT(period < ADAPT_DEFAULT_BUDGET && stats.faster == 3);
+
+	for(uint32_t i = 0; i < ADAPT_TEST_SAMPLES * 4; i++){
+		value += period * 100 / ADAPT_MS_PER_MIN;
+		adapt_sample(time, value);
+		time += period;
+	}
+	EFM_ASSERT(stats.budget > 0 && credit <= 0 && period == ADAPT_DEFAULT_BUDGET);
+
+	apply_cb = saved_cb;
+	adapt_defaults();
+}
@@ -13,6 +13,12 @@
 #include "app.h"
 #include "letimer.h"
 #include "SI7021.h"
+#include "command.h"
+#include "format.h"
+#include <string.h>
+#if defined(SI7021_TEST_ENABLED) || defined(CODEC_BENCH_ENABLED)
+#include "bench.h"
+#endif
 
 
 //***********************************************************************************
@@ -23,6 +29,18 @@
 //***********************************************************************************
 // global variables
 //***********************************************************************************
+static FILTER temp_filter;
+
+
+//***********************************************************************************
+// private function prototypes
+//***********************************************************************************
+static void app_batch_flush(const BATCH_SAMPLE *samples, uint32_t count);
+static void app_send_samples(const BATCH_SAMPLE *samples, uint32_t count);
+static void app_backfill(void);
+static void app_stats_summary(const STATS_SUMMARY *summary);
+static void app_config_changed(CONFIG_KEY key);
+static bool app_apply_period(uint32_t period, uint32_t slope);
 
 
 //***********************************************************************************
@@ -46,8 +64,17 @@ void app_peripheral_setup(void){
 	gpio_open();
 	scheduler_open();
 	sleep_open();
-	app_letimer_pwm_open(PWM_PER, PWM_ACT_PER);
+	command_open();
+	config_open(app_config_changed);
+	app_letimer_pwm_open(config_get(CONFIG_PERIOD), config_get(CONFIG_ACTIVE));
 	si7021_i2c_open(SI7021_READ_EVT);
+	batch_open(app_batch_flush);
+	flash_log_open();
+	change_open();
+	EFM_ASSERT(filter_configure(&temp_filter, TEMP_FILTER_DEFAULT));
+	filter_open(&temp_filter);
+	stats_open(app_stats_summary);
+	adapt_open(app_apply_period, config_get(CONFIG_PERIOD));
 	add_scheduled_event(BOOT_UP_EVT);
 }
 /***************************************************************************//**
@@ -63,20 +90,21 @@ void app_peripheral_setup(void){
  * 	This function is the proper way to call the initialization of the letimer.
  *
  *
- * @param[in] period The duration of each PWM wave in seconds.
+ * @param[in] period The duration of each PWM wave in ms.
  *
  *
- * @param[in] act_period The duration of the time where the PWM wave is high.
+ * @param[in] act_period The duration of the time where the PWM wave is high in ms.
  *
  ******************************************************************************/
-void app_letimer_pwm_open(float period, float act_period){
+void app_letimer_pwm_open(uint32_t period, uint32_t act_period){
 	// Initializing LETIMER0 for PWM operation by creating the
 	// letimer_pwm_struct and initializing all of its elements
 	APP_LETIMER_PWM_TypeDef letimer_pwm_struct;
 
 
-	letimer_pwm_struct.active_period = act_period;
-	letimer_pwm_struct.period = period;
+	letimer_pwm_struct.active_period = act_period * PWM_US_PER_MS;
+	letimer_pwm_struct.period = period * PWM_US_PER_MS;
+	letimer_pwm_struct.max_period = PWM_MAX_PERIOD * PWM_US_PER_MS;
 	letimer_pwm_struct.enable = false;
 	letimer_pwm_struct.out_pin_0_en = LETIMER0_OUT0_EN;
 	letimer_pwm_struct.out_pin_1_en = LETIMER0_OUT1_EN;
@@ -100,7 +128,7 @@ void app_letimer_pwm_open(float period, float act_period){
  * @details
  * Removes the LETIMER_IF_UF event from the scheduler, then based on what the current blocked energy mode is,
  * it either unblocks the current mode and blocks the next lower energy mode, or if it is in EM4 blocking, it
- * will remove one of the two blockings and block EM0
+ * will remove one of the two blockings and block EM0.  It also checks the AT command in progress for a timeout.
  *
  * @note
  * This function is intended to be called by the scheduler
@@ -113,6 +141,8 @@ void scheduled_letimer0_uf_evt(void){
 	EFM_ASSERT(get_scheduled_events() & LETIMER0_UF_EVT);
 	remove_scheduled_event(LETIMER0_UF_EVT);
 
+	ble_at_poll();
+	app_backfill();
 	si7021_read_temp();
 //	uint32_t current_mode = current_block_energy_mode();
 //	sleep_unblock_mode(current_mode);
@@ -163,6 +193,294 @@ void scheduled_letimer0_comp1_evt(void){
 	remove_scheduled_event(LETIMER0_COMP1_EVT);
 }
 
+/***************************************************************************//**
+ * @brief
+ * Writes the temperature telemetry string, "Temp = 72.5 F\n".
+ *
+ * @details
+ * The temperature is rounded to a tenth of a degree and written with the integer format
+ * functions, the same string sprintf("Temp = %4.1f F\n") wrote.
+ *
+ * @param[out] *buf
+ * Receives at most TEMP_MSG_SIZE characters including the NUL.
+ *
+ * @param[in] centi
+ * The temperature in hundredths of a degree.
+ *
+ * @param[in] celsius
+ * Selects the unit written after the value.
+ *
+ * @return
+ * The number of characters written, without the NUL.
+ *
+ ******************************************************************************/
+static uint32_t app_format_temp(char *buf, int32_t centi, bool celsius){
+	uint32_t len;
+
+	len = format_str(buf, TEMP_MSG_PREFIX);
+	len += format_fixed(buf + len, format_round_div(centi, 10), 1, TEMP_FIELD_WIDTH);
+	len += format_str(buf + len, celsius ? TEMP_MSG_C : TEMP_MSG_F);
+	return len;
+}
+
+#ifdef CODEC_BENCH_ENABLED
+/***************************************************************************//**
+ * @brief
+ * Writes one Celsius sample as the text telemetry string, the text side of codec_benchmark().
+ *
+ ******************************************************************************/
+static uint32_t app_format_sample(char *buf, int32_t centi){
+	return app_format_temp(buf, centi, true);
+}
+#endif
+
+/***************************************************************************//**
+ * @brief
+ * Sends a batch of temperature samples to the connected bluetooth device as one message.
+ *
+ * @details
+ * In the text protocol each sample is a line "Temp = 72.5 F @123400\n" with the ms it was taken,
+ * all formatted straight into one reservation of the ble circular buffer.  In the binary protocol the
+ * batch is packed in centi-C with the codec module, about 2 bytes a sample, and sent as BLE_FRAME_TEMP_BATCH
+ * frames, more than one only if a batch of fast changing samples does not fit in a frame.  With "Batch=1"
+ * a single sample is sent as the unbatched "Temp = 72.5 F\n" string or BLE_FRAME_TEMP frame, so the
+ * original reporting is kept.
+ *
+ * @note
+ * The samples hold the raw SI7021 codes, so the unit is chosen when the batch is sent.
+ *
+ * @param[in] *samples
+ * The samples of the batch, oldest first.
+ *
+ * @param[in] count
+ * The number of samples, at most BATCH_MAX_SAMPLES.
+ *
+ ******************************************************************************/
+static void app_send_samples(const BATCH_SAMPLE *samples, uint32_t count){
+	bool celsius = ble_mode_celsius();
+	bool single = count == 1 && batch_size() == 1;
+	uint32_t len = 0;
+
+	if(ble_protocol() == BLE_PROTOCOL_BINARY){
+		uint8_t payload[BLE_FRAME_MAX_PAYLOAD];
+		BATCH_SAMPLE centi_celsius[BATCH_MAX_SAMPLES];
+		uint32_t sent = 0;
+		uint32_t encoded;
+		if(single){
+			int16_t centi = si7021_code_centi_c(samples[0].value);
+			ble_write_frame(BLE_FRAME_TEMP, (uint8_t *)&centi, sizeof(centi));
+			return;
+		}
+		for(uint32_t i = 0; i < count; i++){
+			centi_celsius[i].time = samples[i].time;
+			centi_celsius[i].value = si7021_code_centi_c(samples[i].value);
+		}
+		while(sent < count){
+			len = codec_encode(centi_celsius + sent, count - sent, TEMP_SAMPLE_INTERVAL, payload, sizeof(payload), &encoded);
+			ble_write_frame(BLE_FRAME_TEMP_BATCH, payload, len);
+			sent += encoded;
+		}
+		return;
+	}
+
+	char *msg = ble_reserve(single ? TEMP_MSG_SIZE : TEMP_BATCH_MSG_SIZE, BLE_MSG_TELEMETRY);
+	if(msg == NULL) return; // dropped by the ble overflow or disconnect policy
+	for(uint32_t i = 0; i < count; i++){
+		int32_t centi = celsius ? si7021_code_centi_c(samples[i].value) : si7021_code_centi_f(samples[i].value);
+		len += app_format_temp(msg + len, centi, celsius);
+		if(!single){
+			len--;	// the timestamp goes before the newline
+			len += format_str(msg + len, TEMP_MSG_TIME);
+			len += format_uint(msg + len, samples[i].time);
+			len += format_str(msg + len, "\n");
+		}
+	}
+	ble_commit(len);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Sends a batch of temperature samples, or adds it to the flash log while no central is connected.
+ *
+ * @note
+ * This function is the flush callback of the batch module.
+ *
+ * @param[in] *samples
+ * The samples of the batch, oldest first.
+ *
+ * @param[in] count
+ * The number of samples, at most BATCH_MAX_SAMPLES.
+ *
+ ******************************************************************************/
+static void app_batch_flush(const BATCH_SAMPLE *samples, uint32_t count){
+	if(!ble_connected() || flash_log_pending()){	// kept in order behind the samples already logged
+		for(uint32_t i = 0; i < count; i++){
+			flash_log_append(&samples[i]);
+		}
+		return;
+	}
+	app_send_samples(samples, count);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Streams the samples logged to flash while no central was connected.
+ *
+ * @details
+ * Batches of the oldest logged samples are sent as long as the bulk lane of the ble circular
+ * buffer has room for a full batch, and are only removed from the log once queued.  Called when
+ * a transmission finishes, so the backlog goes out back to back, and from the LETIMER UF event to
+ * start it after a connection.
+ *
+ ******************************************************************************/
+static void app_backfill(void){
+	BATCH_SAMPLE samples[BATCH_MAX_SAMPLES];
+	uint32_t count;
+
+	if(!ble_connected() || !flash_log_pending()) return;
+	flash_log_sync();
+	while(ble_bulk_space() >= TEMP_BACKFILL_SPACE){
+		count = flash_log_read(samples, BATCH_MAX_SAMPLES);
+		if(count == 0) break;
+		app_send_samples(samples, count);
+		flash_log_consume(count);
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ * Converts hundredths of a degree Fahrenheit to hundredths of a degree Celsius, rounded to nearest.
+ *
+ ******************************************************************************/
+static int32_t app_centi_f_to_c(int32_t centi_f){
+	return format_round_div((centi_f - TEMP_CENTI_F_ZERO) * 5, 9);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Writes one " name=72.5" field of the temperature summary.
+ *
+ ******************************************************************************/
+static uint32_t app_format_stat(char *buf, const char *name, int32_t centi){
+	uint32_t len;
+
+	len = format_str(buf, name);
+	len += format_fixed(buf + len, format_round_div(centi, 10), 1, 0);
+	return len;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Sends the summary of a window of temperature readings to the connected bluetooth device.
+ *
+ * @details
+ * In the text protocol the summary is "Stats n=100 min=70.1 max=72.3 mean=71.2 sd=0.4 F\n" in the
+ * selected unit, in the binary protocol it is a BLE_FRAME_TEMP_STATS frame in centi-C.  The summary
+ * is computed in hundredths of a degree Fahrenheit and converted for Celsius, a difference of at most
+ * a hundredth of a degree.
+ *
+ * @note
+ * This function is the summary callback of the stats module.
+ *
+ * @param[in] *summary
+ * The summary of the window, in hundredths of a degree Fahrenheit.
+ *
+ ******************************************************************************/
+static void app_stats_summary(const STATS_SUMMARY *summary){
+	bool celsius = ble_mode_celsius() || ble_protocol() == BLE_PROTOCOL_BINARY;
+	int32_t min = celsius ? app_centi_f_to_c(summary->min) : summary->min;
+	int32_t max = celsius ? app_centi_f_to_c(summary->max) : summary->max;
+	int32_t mean = celsius ? app_centi_f_to_c(summary->mean) : summary->mean;
+	int32_t stddev = celsius ? format_round_div(summary->stddev * 5, 9) : summary->stddev;
+	uint32_t len;
+
+	if(ble_protocol() == BLE_PROTOCOL_BINARY){
+		uint8_t payload[TEMP_STATS_FRAME_SIZE];
+		uint16_t count = summary->count;
+		int16_t fields[4] = { min, max, mean, stddev };
+		memcpy(payload, &count, sizeof(count));
+		memcpy(payload + sizeof(count), fields, sizeof(fields));
+		ble_write_frame(BLE_FRAME_TEMP_STATS, payload, sizeof(payload));
+		return;
+	}
+
+	char *msg = ble_reserve(TEMP_STATS_MSG_SIZE, BLE_MSG_TELEMETRY);
+	if(msg == NULL) return; // dropped by the ble overflow or disconnect policy
+	len = format_str(msg, "Stats n=");
+	len += format_uint(msg + len, summary->count);
+	len += app_format_stat(msg + len, " min=", min);
+	len += app_format_stat(msg + len, " max=", max);
+	len += app_format_stat(msg + len, " mean=", mean);
+	len += app_format_stat(msg + len, " sd=", stddev);
+	len += format_str(msg + len, celsius ? TEMP_MSG_C : TEMP_MSG_F);
+	ble_commit(len);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Applies a setting changed over bluetooth that takes effect at run time.
+ *
+ * @details
+ * A new PWM period becomes the base period of the adaptive sampling, used straight away while
+ * the controller is off.  A new active time is handed to the LETIMER with the period in use.
+ * The LETIMER switches on an underflow without stopping, so the sampling rate changes without
+ * a reset.  The other settings are read when their module is opened.
+ *
+ * @note
+ * This function is the change callback of the config module.
+ *
+ * @param[in] key
+ * The setting that changed.
+ *
+ ******************************************************************************/
+static void app_config_changed(CONFIG_KEY key){
+	if(key == CONFIG_PERIOD){
+		adapt_set_base(config_get(CONFIG_PERIOD));
+	}
+	if(key == CONFIG_ACTIVE){
+		// refused while the adaptive period is not longer than the new active time
+		letimer_set_period(LETIMER0, adapt_period() * PWM_US_PER_MS, config_get(CONFIG_ACTIVE) * PWM_US_PER_MS);
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ * Moves the LETIMER to a sample period chosen by the adaptive sampling and logs the decision.
+ *
+ * @details
+ * The LETIMER switches to the period on an underflow without stopping.  Every change is sent
+ * as "Adapt period=1550 slope=72\n", the slope in hundredths of a degree F per minute, so the
+ * decisions can be followed from the phone.
+ *
+ * @note
+ * This function is the apply callback of the adapt module.
+ *
+ * @param[in] period
+ * The new period in ms.
+ *
+ * @param[in] slope
+ * The slope that chose the period.
+ *
+ * @return
+ * false if the period is not longer than the PWM active time.
+ *
+ ******************************************************************************/
+static bool app_apply_period(uint32_t period, uint32_t slope){
+	char msg[ADAPT_LOG_SIZE];
+	uint32_t len;
+
+	if(!letimer_set_period(LETIMER0, period * PWM_US_PER_MS, config_get(CONFIG_ACTIVE) * PWM_US_PER_MS)){
+		return false;
+	}
+	len = format_str(msg, "Adapt period=");
+	len += format_uint(msg + len, period);
+	len += format_str(msg + len, " slope=");
+	len += format_uint(msg + len, slope);
+	format_str(msg + len, "\n");
+	ble_reply(msg);
+	return true;
+}
+
 /***************************************************************************//**
  * @brief
  * This is the routine called by the scheduler when the si7021 event is triggered,
@@ -171,7 +489,17 @@ void scheduled_letimer0_comp1_evt(void){
  *
  *
  * @details
- * Removes the SI7021_READ_EVT event from the scheduler. And controls the LED
+ * Removes the SI7021_READ_EVT event from the scheduler. And controls the LED.  LED1 turns on at the
+ * alert limit and only turns off once the temperature falls more than the change delta below it, so a
+ * reading hovering at the limit does not toggle the LED or repeat the alert.  The raw temperature code is
+ * first run through the temperature filter, set with "Filter=", and everything after works on the
+ * filtered code, so one noisy reading neither reaches the phone nor flips the LED.  The change module decides
+ * if the reading is reported, and a reported reading is added to the batch with the ms it was taken.
+ * The batch module calls app_batch_flush() once it holds "Batch=" samples or its first sample is
+ * "Latency=" ms old.  When the temperature first crosses the alert limit the reading is always reported
+ * and the batch is flushed straight away, so the readings leading up to the alert arrive with it.  Every
+ * filtered reading also goes to the stats module, which sends a summary once per "Window=" readings,
+ * and to the adapt module, which lengthens or shortens the sample period with "Adapt=1".
  *
  * @note
  * this function occurs every time a measurement is made
@@ -182,29 +510,31 @@ void scheduled_letimer0_comp1_evt(void){
 void scheduled_si7021_done_evt(void){
 	EFM_ASSERT(get_scheduled_events() & SI7021_READ_EVT);
 	remove_scheduled_event(SI7021_READ_EVT);
-	float temp;
-	temp = si7021_i2c_data();
-	if(temp >= 80){
+	static bool over_limit = false;
+	uint32_t now = letimer_ms(LETIMER0);
+	uint32_t code = filter_run(&temp_filter, si7021_temp_code());
+	int32_t temp_f = si7021_code_centi_f(code);
+	bool alert = false;
+
+	if(!over_limit && temp_f >= TEMP_ALERT_CENTI_F){
+		alert = true;
+		over_limit = true;
 		GPIO_PinOutSet(LED1_port, LED1_pin);
 	}
-	else{
+	else if(over_limit && temp_f < TEMP_ALERT_CENTI_F - change_delta()){
+		over_limit = false;
 		GPIO_PinOutClear(LED1_port, LED1_pin);
 	}
 
-	char temp_arr[16];
-	if(ble_mode_celsius()){
-		temp = (temp-32)*5/9;
-		sprintf(temp_arr,"Temp = %4.1f C\n", temp);
+	stats_add(temp_f);
+	adapt_sample(now, temp_f);
+	if(change_report(temp_f, alert)){
+		batch_add(now, code);
 	}
-	else{
-		//	gcvt(temp, 3, temp_val);
-		//	sprintf(temp_arr,"Temp = %s F\n", temp_val);
-		sprintf(temp_arr,"Temp = %4.1f F\n", temp);
+	if(alert){
+		batch_flush();
+		ble_write_alert(TEMP_ALERT_MSG);	// only when the temperature first crosses the limit
 	}
-
-
-	ble_write(temp_arr);
-
 }
 
 
@@ -213,25 +543,71 @@ void scheduled_si7021_done_evt(void){
  *This function is setup up to contain values necessary for the boot up of the Pearl Gecko
  *
  * @details
- * This tests the circular buffer, then writes "\nHello World\n", "Circular Buffer Lab\n" and
+ * This tests the circular buffer, the format functions, the filters, the stats, the codec and the adaptive sampling, then writes "\nHello World\n", "Circular Buffer Lab\n" and
  *  "Justin Thwaites\n" to the bluetooth device and if the test is enabled, it changes the
  *  name of the device to "JTBLE"
  *
  * @note
- * This function should only be called once from the while loop in main.c. If BLE_TEST_ENABLED then optimization settings must be -O0
+ * This function should only be called once from the while loop in main.c.
  *
  ******************************************************************************/
 
 void scheduled_boot_up_evt(void){
 	EFM_ASSERT(get_scheduled_events() & BOOT_UP_EVT);
 	remove_scheduled_event(BOOT_UP_EVT);
-	ble_open(LEUART0_TX_DONE_EVT,LEUART0_RX_DONE_EVT);
+	ble_open(LEUART0_TX_DONE_EVT,LEUART0_RX_DONE_EVT,BLE_AT_DONE_EVT);
+	circular_buff_test();	// before any AT command is queued, which would keep the transmitter busy
 	/* Call to start the LETIMER operation */
 	#ifdef BLE_TEST_ENABLED
-	EFM_ASSERT(ble_test("JTBLE"));
-	for (int i = 0; i < 20000000; i++);
+	EFM_ASSERT(ble_at_set_name(BLE_MODULE_NAME));	// answered while the CPU sleeps, see scheduled_ble_at_done_evt()
+	#endif
+	format_test();
+	filter_test();
+	stats_test();
+	codec_test();
+	adapt_test();
+	#ifdef BLE_BENCH_ENABLED
+	ble_circ_benchmark();
+	#endif
+	#ifdef SI7021_TEST_ENABLED
+	SI7021_TEST_RESULT conversion;
+	char report[SI7021_REPORT_SIZE];
+	char temp_bench[TEMP_MSG_SIZE];
+	uint32_t report_len;
+	uint32_t start;
+	si7021_conversion_test(&conversion);
+	report_len = format_str(report, "conv float ");
+	report_len += format_uint(report + report_len, conversion.float_cycles);
+	report_len += format_str(report + report_len, " cyc int ");
+	report_len += format_uint(report + report_len, conversion.int_cycles);
+	report_len += format_str(report + report_len, " cyc fmt ");
+	bench_open();
+	start = bench_cycles();
+	for(int32_t centi = 0; centi < TEMP_BENCH_SAMPLES; centi++){
+		app_format_temp(temp_bench, centi, false);
+	}
+	report_len += format_uint(report + report_len, (bench_cycles() - start) / TEMP_BENCH_SAMPLES);
+	format_str(report + report_len, " cyc\n");
+	ble_write(report);
+	#endif
+	#ifdef CODEC_BENCH_ENABLED
+	CODEC_BENCH_RESULT packing;
+	char codec_report[CODEC_REPORT_SIZE];
+	uint32_t codec_len;
+	codec_benchmark(app_format_sample, &packing);
+	codec_len = format_str(codec_report, "codec n=");
+	codec_len += format_uint(codec_report + codec_len, packing.samples);
+	codec_len += format_str(codec_report + codec_len, " text ");
+	codec_len += format_uint(codec_report + codec_len, packing.text_bytes);
+	codec_len += format_str(codec_report + codec_len, " B ");
+	codec_len += format_uint(codec_report + codec_len, packing.text_cycles);
+	codec_len += format_str(codec_report + codec_len, " cyc packed ");
+	codec_len += format_uint(codec_report + codec_len, packing.packed_bytes);
+	codec_len += format_str(codec_report + codec_len, " B ");
+	codec_len += format_uint(codec_report + codec_len, packing.packed_cycles);
+	format_str(codec_report + codec_len, " cyc\n");
+	ble_write(codec_report);
 	#endif
-	circular_buff_test();
 	ble_write("\nHello World\n");
 	ble_write("Circular Buffer Lab\n");
 	ble_write("Justin Thwaites\n");
@@ -255,6 +631,7 @@ void leuart0_tx_done_evt(void){
 	remove_scheduled_event(LEUART0_TX_DONE_EVT);
 	letimer_start(LETIMER0, true);
 	ble_circ_pop(CIRC_OPER);
+	app_backfill();
 }
 
 /***************************************************************************//**
@@ -273,3 +650,24 @@ void leuart0_rx_done_evt(void){
 	remove_scheduled_event(LEUART0_RX_DONE_EVT);
 	ble_update_mode();
 }
+
+/***************************************************************************//**
+ * @brief
+ * This event occurs when the AT commands sent to the HM10 have all been answered or one timed out.
+ *
+ * @details
+ * This function first makes sure it is called because of the event, then removes the event and, when the
+ * BLE test is enabled, checks that the HM10 accepted the commands.  At boot the AT+NOTI1 command times out
+ * if a phone is already connected, which is not an error.
+ *
+ * @note
+ * The telemetry held on the circular buffer while the commands were sent is transmitted from here on.
+ *
+ ******************************************************************************/
+void scheduled_ble_at_done_evt(void){
+	EFM_ASSERT(get_scheduled_events() & BLE_AT_DONE_EVT);
+	remove_scheduled_event(BLE_AT_DONE_EVT);
+	#ifdef BLE_TEST_ENABLED
+	EFM_ASSERT(ble_at_status() == BLE_AT_OK);
+	#endif
+}
@@ -0,0 +1,169 @@
+/**
+ * @file batch.c
+ * @author Justin Thwaites
+ * @date 5/22/2020
+ * @brief Collects timestamped samples so several are reported in one BLE transmission
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include "batch.h"
+
+//***********************************************************************************
+// private variables
+//***********************************************************************************
+static BATCH_SAMPLE samples[BATCH_MAX_SAMPLES];
+static uint32_t sample_count;
+static uint32_t samples_per_batch;
+static uint32_t latency;
+static BATCH_FLUSH_CB flush_cb;
+
+/***************************************************************************//**
+ * @brief Batch module
+ * @details
+ *  Samples are held in RAM and handed to the flush callback together, so the
+ *  UART and HM10 wake once per batch instead of once per sample.  A batch is
+ *  flushed when it holds the configured number of samples, when its first
+ *  sample is older than the latency deadline, or when the application flushes
+ *  it, for example on an alert.  The module does not know how a batch is
+ *  formatted or sent, that is left to the callback.
+ *
+ ******************************************************************************/
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ * Command handlers for the batch size and latency.
+ *
+ * @note
+ *	These functions are private and are called through the command table.
+ ******************************************************************************/
+static CMD_STATUS batch_cmd_size(CMD_ARG *arg){
+	return batch_set_size(arg->value) ? CMD_OK : CMD_BAD_ARG;
+}
+
+static CMD_STATUS batch_cmd_latency(CMD_ARG *arg){
+	return batch_set_latency(arg->value) ? CMD_OK : CMD_BAD_ARG;
+}
+
+static const CMD_ENTRY batch_commands[] = {
+	{ BATCH_SIZE_MESSAGE,		CMD_ARG_INT, 1, BATCH_MAX_SAMPLES, batch_cmd_size },
+	{ BATCH_LATENCY_MESSAGE,	CMD_ARG_INT, 0, BATCH_MAX_LATENCY, batch_cmd_latency },
+};
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *	Sets up an empty batch and registers the batch commands.
+ *
+ * @note
+ *	This function should only be called once in setup of the device, after command_open().
+ *
+ * @param[in] flush
+ *	Called with the samples of a batch, oldest first, when the batch is flushed.
+ ******************************************************************************/
+void batch_open(BATCH_FLUSH_CB flush){
+	EFM_ASSERT(flush != NULL);
+	flush_cb = flush;
+	sample_count = 0;
+	samples_per_batch = BATCH_DEFAULT_SAMPLES;
+	latency = BATCH_DEFAULT_LATENCY;
+	for(int i = 0; i < sizeof(batch_commands) / sizeof(batch_commands[0]); i++){
+		command_register(&batch_commands[i]);
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Adds a sample to the batch and flushes the batch if it is full or past its deadline.
+ *
+ * @details
+ *	The deadline is checked when a sample is added, so a batch is flushed no later than
+ *	the first sample after the deadline.
+ *
+ * @param[in] time
+ *	ms when the sample was taken.
+ *
+ * @param[in] value
+ *	The sample.
+ ******************************************************************************/
+void batch_add(uint32_t time, int32_t value){
+	samples[sample_count].time = time;
+	samples[sample_count].value = value;
+	sample_count++;
+	if(sample_count >= samples_per_batch || time - samples[0].time >= latency){
+		batch_flush();
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Hands the samples held to the flush callback and empties the batch.
+ ******************************************************************************/
+void batch_flush(void){
+	if(sample_count == 0) return;
+	flush_cb(samples, sample_count);
+	sample_count = 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Sets the number of samples sent per batch.
+ *
+ * @details
+ *	If the batch already holds that many samples it is flushed.
+ *
+ * @param[in] samples
+ *	1 to BATCH_MAX_SAMPLES, 1 sends every sample on its own.
+ *
+ * @return
+ *	false if the number is out of range.
+ ******************************************************************************/
+bool batch_set_size(uint32_t samples){
+	if(samples < 1 || samples > BATCH_MAX_SAMPLES) return false;
+	samples_per_batch = samples;
+	if(sample_count >= samples_per_batch){
+		batch_flush();
+	}
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Sets the longest time a sample waits in the batch.
+ *
+ * @param[in] ms
+ *	0 to BATCH_MAX_LATENCY.
+ *
+ * @return
+ *	false if the latency is out of range.
+ ******************************************************************************/
+bool batch_set_latency(uint32_t ms){
+	if(ms > BATCH_MAX_LATENCY) return false;
+	latency = ms;
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Returns the number of samples sent per batch.
+ ******************************************************************************/
+uint32_t batch_size(void){
+	return samples_per_batch;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Returns the longest time in ms a sample waits in the batch.
+ ******************************************************************************/
+uint32_t batch_latency(void){
+	return latency;
+}
@@ -0,0 +1,40 @@
+/**
+ * @file bench.c
+ * @author Justin Thwaites
+ * @date 5/10/2020
+ * @brief Cycle counter used by the on target benchmarks
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include "bench.h"
+
+//***********************************************************************************
+// functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *	Enables the DWT cycle counter of the Cortex-M4 core.
+ *
+ * @note
+ *	The counter runs at the core clock and wraps every 2^32 cycles, so benchmarks
+ *	should only subtract readings taken close together.
+ *
+ ******************************************************************************/
+void bench_open(void){
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Returns the current value of the core cycle counter.
+ *
+ ******************************************************************************/
+uint32_t bench_cycles(void){
+	return DWT->CYCCNT;
+}
@@ -13,6 +13,10 @@
 //***********************************************************************************
 #include "ble.h"
 #include <string.h>
+#include "format.h"
+#ifdef BLE_BENCH_ENABLED
+#include "bench.h"
+#endif
 
 //***********************************************************************************
 // defined files
@@ -23,8 +27,53 @@
 // private variables
 //***********************************************************************************
 static CIRC_TEST_STRUCT test_struct;
-static BLE_CIRCULAR_BUF ble_cbuf;
+static SPSC_RING ble_lanes[BLE_LANES];
+static uint8_t ble_bulk_storage[BLE_CIRC_SIZE];
+static uint8_t ble_alert_storage[BLE_ALERT_CIRC_SIZE];
+static BLE_LANE_STATS lane_stats[BLE_LANES];
+static uint32_t ble_tx_in_flight;		// messages being sent straight from the circular buffer
+static BLE_LANE ble_tx_lane;			// lane of the messages in flight
+static uint32_t alert_streak;			// alert transfers sent while bulk was waiting
+static BLE_MSG_CLASS reserve_class;
+static BLE_LANE reserve_lane;
+static char *reserve_record;
+static BLE_OVERFLOW_POLICY overflow_policy;
+static BLE_DROP_STATS drop_stats;
 static bool is_celsius;
+static BLE_TRANSPORT transport;
+static BLE_TRANSPORT transport_pending;	// transport the AT commands in progress switch to, else transport
+static bool transport_auto;
+static bool transport_settling;			// the HM10 is restarting with the new baud rate
+static bool transport_probe;			// looking for the HM10 at both rates after a reset, see ble_transport_probe()
+static uint32_t probe_tries;
+static uint32_t baud_request;			// LEUART rate set at the next disconnection, 0 for none
+static bool baud_queued;				// AT+BAUD and AT+RESET for baud_request are in progress
+static uint32_t settle_deadline;		// letimer_ms() at which the HM10 has restarted
+static uint32_t ble_tx_event;
+static uint32_t ble_rx_event;
+static BLE_PROTOCOL protocol;
+static BLE_FRAME_STATS frame_stats;
+static BLE_AT_CMD at_queue[BLE_AT_QUEUE_SIZE];
+static uint32_t at_head;
+static uint32_t at_count;
+static bool at_sent;					// the command at the head is waiting for its response
+static uint32_t at_match;				// characters of the expected response received so far
+static uint32_t at_deadline;			// letimer_ms() at which the response times out
+static BLE_AT_STATUS at_status;
+static uint32_t ble_at_event;
+static bool connected;					// a central is connected to the HM10
+static BLE_DISCONNECT_POLICY disconnect_policy;
+static BLE_CONN_STATS conn_stats;
+static BLE_MODULE_STATE module_state;
+static bool module_sleep;				// the HM10 is put to sleep while idle and disconnected
+static bool module_auto_sleep;			// the HM10 puts itself to sleep while disconnected
+static bool auto_sleep_pending;			// module_auto_sleep is changed at the next disconnection
+static bool auto_sleep_request;
+static bool sleep_retry;				// cleared by a timeout so an unanswered AT+SLEEP is not repeated
+static char hm10_wake[HM10_WAKE_LEN + 1];
+static const BLE_BAUD_CODE baud_codes[] = {
+	{ 9600, '0' }, { 4800, '5' }, { 2400, '6' }, { 1200, '7' },
+};
 /***************************************************************************//**
  * @brief BLE module
  * @details
@@ -42,65 +91,892 @@ static bool is_celsius;
 
 /***************************************************************************//**
  * @brief
- * This function returns the available space on the circular buffer.
+ * Returns if the active transport is in the middle of a transmission.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ ******************************************************************************/
+static bool ble_tx_busy(void){
+	if(transport == BLE_TRANSPORT_USART){
+		return usart_tx_busy(HM10_USART);
+	}
+	return leuart_tx_busy(HM10_LEUART0);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Starts an interrupt driven transmission of one or more messages on the active transport.
+ *
+ * @param[in] *segments
+ * The messages to send to the HM10 as one transfer.
+ *
+ * @param[in] count
+ * The number of messages.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ ******************************************************************************/
+static void ble_tx_start(TX_SEGMENT *segments, uint32_t count){
+	if(transport == BLE_TRANSPORT_USART){
+		usart_start_segments(HM10_USART, segments, count);
+	}
+	else{
+		leuart_start_segments(HM10_LEUART0, segments, count);
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ * Takes the oldest message received from the HM10 off the active transport's RX queue.
+ *
+ * @param[out] *message
+ * A LEUART_MSG_SIZE array that receives the NUL terminated message.
+ *
+ * @return
+ * false if no message is waiting.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ ******************************************************************************/
+static bool ble_rx_message(char *message){
+	if(transport == BLE_TRANSPORT_USART){
+		return usart_rx_read(message);
+	}
+	return leuart_rx_read(message);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Switches the receiver of the active transport to or from raw reception for the AT responses.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ ******************************************************************************/
+static void ble_rx_raw(bool enable){
+	if(transport == BLE_TRANSPORT_USART){
+		usart_rx_raw(HM10_USART, enable);
+	}
+	else{
+		leuart_rx_raw(HM10_LEUART0, enable);
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns the digit of AT+BAUD that selects a LEUART baud rate on the HM10.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ ******************************************************************************/
+static char ble_baud_code(uint32_t baud){
+	for(int i = 0; i < sizeof(baud_codes) / sizeof(baud_codes[0]); i++){
+		if(baud_codes[i].baud == baud) return baud_codes[i].code;
+	}
+	EFM_ASSERT(false);		// config_set() only allows the rates in the table
+	return baud_codes[0].code;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Hands the pins to the transport the HM10 has just been switched to.
+ *
+ * @details
+ * Nothing is sent for HM10_RESET_DELAY ms while the HM10 restarts at the new baud rate.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.  The transport
+ *	must not be busy.
+ ******************************************************************************/
+static void ble_transport_handoff(void){
+	USART_OPEN_STRUCT open_usart;
+
+	if(transport_pending == BLE_TRANSPORT_USART){
+		open_usart.baudrate = HM10_FAST_BAUDRATE;
+		open_usart.databits = HM10_USART_DATABITS;
+		open_usart.enable = HM10_USART_ENABLE;
+		open_usart.parity = HM10_USART_PARITY;
+		open_usart.ref_freq = HM10_REFFREQ;
+		open_usart.stopbits = HM10_USART_STOPBITS;
+		open_usart.rx_done_evt = ble_rx_event;
+		open_usart.tx_done_evt = ble_tx_event;
+		open_usart.rx_loc = USART0_RX_ROUTE;
+		open_usart.tx_loc = USART0_TX_ROUTE;
+		open_usart.rx_pin_en = true;
+		open_usart.tx_pin_en = true;
+		leuart_route(HM10_LEUART0, false);
+		usart_open(HM10_USART, &open_usart);
+		usart_rx_watch(HM10_USART, HM10_CONN_NOTE);
+		usart_rx_watch(HM10_USART, HM10_LOST_NOTE);
+		usart_rx_delimited(HM10_USART, protocol == BLE_PROTOCOL_BINARY);
+	}
+	else{
+		usart_close(HM10_USART);
+		leuart_route(HM10_LEUART0, true);
+	}
+	transport = transport_pending;
+	settle_deadline = letimer_ms(BLE_AT_TIMER) + HM10_RESET_DELAY;
+	transport_settling = true;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Queues AT+BAUD with the code of a baud rate followed by AT+RESET.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ ******************************************************************************/
+static bool ble_baud_queue(char code){
+	char baud_cmd[] = HM10_BAUD_CMD "0";
+	char baud_resp[] = HM10_BAUD_RESP "0";
+
+	baud_cmd[sizeof(baud_cmd) - 2] = code;
+	baud_resp[sizeof(baud_resp) - 2] = code;
+	return ble_at_queue(baud_cmd, baud_resp, BLE_AT_TIMEOUT)
+			&& ble_at_queue(HM10_RESET_CMD, HM10_RESET_RESP, BLE_AT_TIMEOUT);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Queues the AT+BAUD and AT+RESET commands that move the HM10 to the baud rate of a transport.
+ *
+ * @details
+ * The pins are handed over by ble_at_finish() once both are answered.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.  The caller checks
+ *	that no switch is in progress.
+ ******************************************************************************/
+static bool ble_transport_queue(BLE_TRANSPORT new_transport){
+	char code;
+
+	if(new_transport == BLE_TRANSPORT_USART){
+		code = HM10_BAUD_FAST_CODE;
+	}
+	else{
+		code = ble_baud_code(config_get(CONFIG_BAUD));
+	}
+	if(!ble_baud_queue(code)) return false;
+	transport_pending = new_transport;	// set last, ble_at_queue() refuses commands during a switch
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Makes the next attempt to find the HM10 after a reset that may have left it at the fast rate.
  *
  * @details
- * This uses the property that the (read_ptr + buffer_size) - write_ptr will be equal to the empty space.
+ * AT+BAUD changes the rate the HM10 keeps across its own resets, so after an MCU reset it may
+ * still be at HM10_FAST_BAUDRATE.  Even attempts move it back to the configured rate from the
+ * USART, odd attempts send AT+NOTI1 on the LEUART at the configured rate, and the first answer
+ * ends the search.  Neither is answered while a central is connected, so the search gives up
+ * on the LEUART after HM10_PROBE_TRIES attempts.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.  No AT command
+ *	may be queued.
+ ******************************************************************************/
+static void ble_transport_probe(void){
+	if(probe_tries % 2 == 0){
+		transport_pending = BLE_TRANSPORT_USART;
+		ble_transport_handoff();
+		ble_transport_queue(BLE_TRANSPORT_LEUART);
+	}
+	else{
+		ble_at_queue(HM10_NOTI_CMD, HM10_NOTI_RESP, BLE_AT_TIMEOUT);
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ * Ends the AT command engine run and schedules the completion event.
+ *
+ * @details
+ * The remaining commands are dropped, the transport is returned to its normal reception mode
+ * and the messages held on the circular buffer are sent.  A transport switch in progress is
+ * completed if every command was answered, and abandoned otherwise.  While the HM10 is being
+ * looked for after a reset, a switch is completed either way and the next attempt is made
+ * instead of reporting the timeout.  Once the HM10 answers at the LEUART rate it is recorded
+ * in the config, so the next reset does not look for it.  A LEUART rate change requested with
+ * ble_set_baud() is stored in the config only once the HM10 has taken it, and the LEUART
+ * follows the HM10 to the new rate.
+ *
+ * @param[in] status
+ * The result of the run, read back with ble_at_status().
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ ******************************************************************************/
+static void ble_at_finish(BLE_AT_STATUS status){
+	at_count = 0;
+	at_sent = false;
+	if(status == BLE_AT_TIMED_OUT) sleep_retry = false;
+	ble_rx_raw(false);
+	if(baud_queued){
+		baud_queued = false;
+		if(status == BLE_AT_OK){
+			leuart_set_baud(HM10_LEUART0, HM10_REFFREQ, baud_request);
+			config_set(CONFIG_BAUD, baud_request);
+			settle_deadline = letimer_ms(BLE_AT_TIMER) + HM10_RESET_DELAY;
+			transport_settling = true;
+		}
+		baud_request = 0;
+	}
+	if(transport_pending != transport){
+		if(status == BLE_AT_OK || transport_probe){
+			ble_transport_handoff();
+		}
+		else{
+			transport_pending = transport;
+		}
+	}
+	if(transport_probe && status != BLE_AT_OK && ++probe_tries < HM10_PROBE_TRIES){
+		ble_transport_probe();
+		return;
+	}
+	transport_probe = false;
+	at_status = status;
+	if(status == BLE_AT_OK && transport == BLE_TRANSPORT_LEUART){
+		config_set(CONFIG_HM10_FAST, false);
+	}
+	add_scheduled_event(ble_at_event);
+	ble_circ_pop(CIRC_OPER);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Transmits the AT command, or the wake string, at the head of the queue and starts its timeout.
+ *
+ * @details
+ * The LETIMER is started so the timeout advances, and its UF event checks the timeout
+ * while the CPU sleeps.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.  The transport
+ *	must not be busy.
+ ******************************************************************************/
+static void ble_at_send(void){
+	BLE_AT_CMD *cmd = &at_queue[at_head];
+	TX_SEGMENT segment;
+
+	letimer_start(BLE_AT_TIMER, true);
+	at_deadline = letimer_ms(BLE_AT_TIMER) + cmd->timeout;
+	at_match = 0;
+	at_sent = true;
+	if(cmd->wake){
+		segment.data = hm10_wake;
+		segment.len = HM10_WAKE_LEN;
+	}
+	else{
+		segment.data = cmd->cmd;
+		segment.len = strlen(cmd->cmd);
+	}
+	ble_tx_start(&segment, 1);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Matches received characters against the response expected for the AT command in progress.
+ *
+ * @details
+ * Characters that do not fit the expected response, such as an OK+LOST sent by the HM10 on
+ * its own, restart the match.  Once the whole response has been received the next command
+ * is sent, or the run ends.
+ *
+ * @param[in] *message
+ * The characters received, NUL terminated.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ ******************************************************************************/
+static void ble_at_receive(char *message){
+	char *response = at_queue[at_head].response;
+
+	if(!at_sent) return;
+	for(; *message; message++){
+		if(*message == response[at_match]){
+			at_match++;
+		}
+		else{
+			at_match = (*message == response[0]);
+		}
+		if(response[at_match] == 0){
+			connected = false;	// the HM10 only answers AT commands with no central connected
+			sleep_retry = true;
+			if(at_queue[at_head].wake){
+				module_state = BLE_MODULE_AWAKE;
+				conn_stats.module_wakes++;
+			}
+			else if(strcmp(response, HM10_SLEEP_RESP) == 0){
+				module_state = BLE_MODULE_ASLEEP;
+				conn_stats.module_sleeps++;
+			}
+			at_head = (at_head + 1) % BLE_AT_QUEUE_SIZE;
+			at_count--;
+			at_sent = false;
+			if(at_count == 0){
+				ble_at_finish(BLE_AT_OK);
+			}
+			else{
+				ble_circ_pop(CIRC_OPER);	// sends the next command once the transport is free
+			}
+			return;
+		}
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ * Adds a command to the end of the AT command queue.
+ *
+ * @param[in] *cmd
+ * The AT command, ignored for the wake string.
+ *
+ * @param[in] *response
+ * The response expected from the HM10.
+ *
+ * @param[in] timeout
+ * ms to wait for the response.
+ *
+ * @param[in] wake
+ * true to send the wake string instead of a command.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.  The caller checks
+ *	there is room.
+ ******************************************************************************/
+static void ble_at_push(char *cmd, char *response, uint32_t timeout, bool wake){
+	BLE_AT_CMD *entry = &at_queue[(at_head + at_count) % BLE_AT_QUEUE_SIZE];
+
+	strcpy(entry->cmd, cmd);
+	strcpy(entry->response, response);
+	entry->timeout = timeout;
+	entry->wake = wake;
+	if(at_count++ == 0){
+		at_status = BLE_AT_BUSY;
+		ble_rx_raw(true);
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ * Puts the HM10 to sleep once it is idle with no central connected.
+ *
+ * @details
+ * With auto sleep the HM10 goes to sleep by itself and is only marked as asleep.  Otherwise
+ * AT+SLEEP is queued.  A central connecting wakes the module again.  An auto sleep change
+ * requested during a connection is queued here once the central has gone.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ ******************************************************************************/
+static void ble_module_sleep_check(void){
+	if(auto_sleep_pending && !connected){
+		auto_sleep_pending = !ble_module_auto_sleep(auto_sleep_request);
+	}
+	if(!module_sleep || connected || !sleep_retry || transport_settling) return;
+	if(at_count > 0 || module_state == BLE_MODULE_ASLEEP || ble_tx_busy()) return;
+	if(module_auto_sleep){
+		module_state = BLE_MODULE_ASLEEP;
+		conn_stats.module_sleeps++;
+		return;
+	}
+	ble_at_push(HM10_SLEEP_CMD, HM10_SLEEP_RESP, BLE_AT_TIMEOUT, false);
+	ble_circ_pop(CIRC_OPER);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Moves the HM10 and the LEUART to the rate requested with ble_set_baud() once the link is idle.
+ *
+ * @details
+ * The HM10 only answers AT commands with no central connected, and the rate is only changed
+ * while the link is on the LEUART, see ble_at_finish().
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ ******************************************************************************/
+static void ble_baud_check(void){
+	if(baud_request == 0 || baud_queued || connected || transport_settling || transport_probe) return;
+	if(transport != BLE_TRANSPORT_LEUART || transport_pending != transport) return;
+	if(at_count > 0 || ble_tx_busy()) return;
+	baud_queued = ble_baud_queue(ble_baud_code(baud_request));
+}
+
+/***************************************************************************//**
+ * @brief
+ * Tracks the connection state from the OK+CONN and OK+LOST notifications of the HM10.
+ *
+ * @details
+ * When a central connects the module wakes and the messages held on the circular buffer are sent.
+ *
+ * @param[in] *message
+ * A received message.
  *
  * @return
- * The available space on the buffer
+ * true if the message was a notification.
  *
  * @note
  *	This function is a private helper function that only has local scope.
  ******************************************************************************/
-static uint8_t ble_circ_space(void){
-	return ble_cbuf.read_ptr + ble_cbuf.size - ble_cbuf.write_ptr;
+static bool ble_notification(char *message){
+	if(strcmp(message, HM10_CONN_NOTE) == 0){
+		if(!connected) conn_stats.connects++;
+		if(module_state == BLE_MODULE_ASLEEP) conn_stats.module_wakes++;
+		connected = true;
+		module_state = BLE_MODULE_AWAKE;	// the connection wakes the module
+		ble_circ_pop(CIRC_OPER);
+		return true;
+	}
+	if(strcmp(message, HM10_LOST_NOTE) == 0){
+		if(connected) conn_stats.disconnects++;
+		connected = false;
+		sleep_retry = true;
+		ble_circ_pop(CIRC_OPER);	// lets the transport be switched while no central is connected
+		return true;
+	}
+	return false;
 }
 
+/***************************************************************************//**
+ * @brief
+ * Picks the transport from the backlog waiting for the next central when the automatic switch is on.
+ *
+ * @details
+ * While disconnected the app logs telemetry to the flash log, so the link moves to the USART once
+ * BLE_BULK_LOG_SAMPLES samples are logged, or BLE_BULK_THRESHOLD bytes are held on the circular
+ * buffer, and the backfill runs at the fast rate when a central connects.  The link moves back
+ * to the LEUART once the circular buffer and the log are empty, or the automatic switch is turned
+ * off.  Only called while no central is connected, since the HM10 does not answer AT commands
+ * during a connection and its restart would drop the connection, so the link does not flap
+ * while messages drain.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ ******************************************************************************/
+static void ble_transport_select(void){
+	uint32_t filled;
+
+	filled = spsc_ring_count(&ble_lanes[BLE_LANE_ALERT]) + spsc_ring_count(&ble_lanes[BLE_LANE_BULK]);
+	if(transport == BLE_TRANSPORT_LEUART && transport_auto
+			&& (filled >= BLE_BULK_THRESHOLD || flash_log_backlog() >= BLE_BULK_LOG_SAMPLES)){
+		ble_set_transport(BLE_TRANSPORT_USART);
+	}
+	else if(transport == BLE_TRANSPORT_USART && (!transport_auto || (filled == 0 && !flash_log_pending()))){
+		ble_set_transport(BLE_TRANSPORT_LEUART);
+	}
+}
 
 /***************************************************************************//**
  * @brief
- * This function updates the write index by a certain specified amount
+ * Removes the messages that were transmitted straight from the circular buffer once the
+ * transmission is done.
  *
  * @details
- * This adds a certain amount to the write pointer, and then uses modulo arithmetic
- * to ensure the value is under the size of the buffer array.
+ * The time from queuing to the end of the transmission is added to the latency of the lane.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ ******************************************************************************/
+static void ble_circ_release(void){
+	uint32_t now;
+	uint32_t stamp;
+	uint32_t len;
+	uint8_t *record;
+
+	if(ble_tx_busy() || ble_tx_in_flight == 0) return;
+	now = letimer_ms(BLE_STAMP_TIMER);
+	for(; ble_tx_in_flight > 0; ble_tx_in_flight--){
+		record = spsc_ring_peek_record(&ble_lanes[ble_tx_lane], &len, NULL);
+		memcpy(&stamp, record, BLE_STAMP_SIZE);
+		lane_stats[ble_tx_lane].messages++;
+		lane_stats[ble_tx_lane].latency_sum += now - stamp;
+		if(now - stamp > lane_stats[ble_tx_lane].latency_max){
+			lane_stats[ble_tx_lane].latency_max = now - stamp;
+		}
+		spsc_ring_consume_record(&ble_lanes[ble_tx_lane]);
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ * Picks the lane to send from next.
  *
- * @param[in] *index_struct
- * The address to the circular buffer struct.
+ * @details
+ * The alert lane has strict priority, except that after BLE_STARVATION_LIMIT alert
+ * transfers in a row the bulk lane gets one transfer if it has anything waiting.  A lane
+ * passed over while it has messages waiting counts it in its stats.
  *
- * @param[in] update_by
- * The number that the write index is needing to be updated by.
+ * @return
+ * The lane to send from, or BLE_LANES if both are empty.
  *
  * @note
  *	This function is a private helper function that only has local scope.
  ******************************************************************************/
-static void update_circ_wrtindex(BLE_CIRCULAR_BUF *index_struct, uint32_t update_by){
-	index_struct->write_ptr = (index_struct->write_ptr + update_by)%index_struct->size ;
+static BLE_LANE ble_circ_lane(void){
+	bool alert = spsc_ring_count(&ble_lanes[BLE_LANE_ALERT]) > 0;
+	bool bulk = spsc_ring_count(&ble_lanes[BLE_LANE_BULK]) > 0;
+
+	if(alert && (!bulk || alert_streak < BLE_STARVATION_LIMIT)){
+		if(bulk){
+			alert_streak++;
+			lane_stats[BLE_LANE_BULK].passed++;
+		}
+		return BLE_LANE_ALERT;
+	}
+	if(alert) lane_stats[BLE_LANE_ALERT].passed++;
+	alert_streak = 0;
+	return bulk ? BLE_LANE_BULK : BLE_LANES;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Drops the oldest message waiting on a lane of the circular buffer.
+ *
+ * @details
+ * Messages being transmitted can not be dropped, since the LEUART is reading them.
+ *
+ * @param[in] lane
+ * The lane to drop from.
+ *
+ * @param[in] telemetry_only
+ * If true an alert message is not dropped.
+ *
+ * @return
+ * true if a message was dropped.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.  The producer may
+ *	remove messages because both ends of the circular buffer are used from the main loop.
+ ******************************************************************************/
+static bool ble_circ_drop_oldest(BLE_LANE lane, bool telemetry_only){
+	uint32_t len;
+	uint32_t msg_class;
+
+	if(ble_tx_in_flight > 0 && ble_tx_lane == lane) return false;
+	if(spsc_ring_peek_record(&ble_lanes[lane], &len, &msg_class) == NULL) return false;
+	if(telemetry_only && msg_class == BLE_MSG_ALERT) return false;
+	spsc_ring_consume_record(&ble_lanes[lane]);
+	return true;
 }
 
 /***************************************************************************//**
  * @brief
- * This function updates the read index by a certain specified amount
+ * Reserves room for a message on the circular buffer, applying the overflow policy when it is full.
  *
  * @details
- * This adds a certain amount to the read pointer, and then uses modulo arithmetic
- * to ensure the value is under the size of the buffer array.
+ * Telemetry is dropped while no central is connected under BLE_DISCONNECT_DROP.
+ * Alert messages go on the alert lane and everything else on the bulk lane.  When the lane is full:
+ * - BLE_OVERFLOW_DROP_NEWEST: the new message is dropped.
+ * - BLE_OVERFLOW_DROP_OLDEST: queued messages are dropped, oldest first, until the new one fits.
+ * - BLE_OVERFLOW_OVERWRITE_TELEMETRY: like drop oldest, but stops at an alert message.
+ * - BLE_OVERFLOW_BLOCK: waits up to BLE_BLOCK_TIMEOUT ms for the transmitter to make room.  The CPU
+ *   sleeps in the lowest energy mode the transfer allows and wakes on its interrupts.  The wait ends
+ *   at once when nothing is being sent, such as while no central is connected or an AT command
+ *   waits for its response, since then nothing can make room.
+ * When the policy can not make room the new message is dropped.  Each case is counted in drop_stats.
  *
- * @param[in] *index_struct
- * The address to the circular buffer struct.
+ * @param[in] len
+ * The number of bytes to reserve.
  *
- * @param[in] update_by
- * The number that the read index is needing to be updated by.
+ * @param[in] msg_class
+ * Whether the message is telemetry or an alert.
+ *
+ * @return
+ * The address to build the message at, or NULL if the message was dropped.
  *
  * @note
  *	This function is a private helper function that only has local scope.
  ******************************************************************************/
-static void update_circ_readindex(BLE_CIRCULAR_BUF *index_struct, uint32_t update_by){
-	index_struct->read_ptr = (index_struct->read_ptr + update_by)%index_struct->size ;
+static char *ble_circ_reserve(uint32_t len, BLE_MSG_CLASS msg_class){
+	BLE_LANE lane = msg_class == BLE_MSG_ALERT ? BLE_LANE_ALERT : BLE_LANE_BULK;
+	char *record;
+	bool blocked = false;
+	uint32_t start = 0;
+
+	ble_circ_release();
+	if(!connected && disconnect_policy == BLE_DISCONNECT_DROP && msg_class == BLE_MSG_TELEMETRY){
+		conn_stats.suppressed++;
+		return NULL;
+	}
+	while((record = spsc_ring_reserve(&ble_lanes[lane], BLE_STAMP_SIZE + len)) == NULL){
+		if(overflow_policy == BLE_OVERFLOW_DROP_OLDEST && ble_circ_drop_oldest(lane, false)){
+			drop_stats.dropped_oldest++;
+			continue;
+		}
+		if(overflow_policy == BLE_OVERFLOW_OVERWRITE_TELEMETRY && ble_circ_drop_oldest(lane, true)){
+			drop_stats.overwritten_telemetry++;
+			continue;
+		}
+		if(overflow_policy == BLE_OVERFLOW_BLOCK && connected){
+			if(!blocked){
+				blocked = true;
+				start = letimer_ms(BLE_STAMP_TIMER);
+				ble_circ_pop(CIRC_OPER);	// frees the messages that were sent and starts the next transfer
+				continue;
+			}
+			if(ble_tx_busy() && letimer_ms(BLE_STAMP_TIMER) - start < BLE_BLOCK_TIMEOUT){
+				__disable_irq();
+				if(ble_tx_busy()) enter_sleep();	// a pending interrupt still ends the sleep
+				__enable_irq();
+				ble_circ_pop(CIRC_OPER);
+				continue;
+			}
+			drop_stats.block_timeouts++;
+		}
+		drop_stats.dropped_newest++;
+		return NULL;
+	}
+	reserve_class = msg_class;
+	reserve_lane = lane;
+	reserve_record = record;
+	return record + BLE_STAMP_SIZE;
 }
 
+/***************************************************************************//**
+ * @brief
+ * Stamps the reserved message with the time it was queued and publishes it.
+ *
+ * @param[in] len
+ * The number of bytes in the message.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ ******************************************************************************/
+static void ble_circ_commit(uint32_t len){
+	uint32_t stamp = letimer_ms(BLE_STAMP_TIMER);
 
+	memcpy(reserve_record, &stamp, BLE_STAMP_SIZE);
+	spsc_ring_commit(&ble_lanes[reserve_lane], BLE_STAMP_SIZE + len, reserve_class);
+}
+
+/***************************************************************************//**
+ * @brief
+ * This function pushes a block of bytes onto the circular buffer.
+ *
+ * @details
+ * The block is stored as a ring record, behind a 16 bit header, so that binary frames,
+ * which may not be NUL terminated, can share the buffer with the text messages.
+ *
+ * @param[in] *data
+ * The bytes of the message.
+ *
+ * @param[in] len
+ * The number of bytes in the message.
+ *
+ * @param[in] msg_class
+ * Whether the message is telemetry or an alert.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ ******************************************************************************/
+static void ble_circ_push_bytes(char *data, uint32_t len, BLE_MSG_CLASS msg_class){
+char *string = ble_circ_reserve(len, msg_class);
+if(string == NULL) return; //dropped by the overflow policy
+memcpy(string, data, len);
+ble_circ_commit(len);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Command handlers for the units, protocol and link settings, and the counter replies.
+ *
+ * @note
+ *	These functions are private and are called through the command table.
+ ******************************************************************************/
+static CMD_STATUS ble_cmd_celsius(CMD_ARG *arg){
+	is_celsius = true;
+	return config_set(CONFIG_CELSIUS, true) ? CMD_OK : CMD_ERROR;
+}
+
+static CMD_STATUS ble_cmd_fahrenheit(CMD_ARG *arg){
+	is_celsius = false;
+	return config_set(CONFIG_CELSIUS, false) ? CMD_OK : CMD_ERROR;
+}
+
+static CMD_STATUS ble_cmd_binary(CMD_ARG *arg){
+	ble_set_protocol(BLE_PROTOCOL_BINARY);
+	return CMD_OK;
+}
+
+static CMD_STATUS ble_cmd_text(CMD_ARG *arg){
+	ble_set_protocol(BLE_PROTOCOL_TEXT);
+	return CMD_OK;
+}
+
+static CMD_STATUS ble_cmd_fast_link(CMD_ARG *arg){
+	ble_transport_auto(arg->value);
+	return CMD_OK;
+}
+
+static CMD_STATUS ble_cmd_overflow(CMD_ARG *arg){
+	ble_set_overflow_policy(arg->value);
+	return CMD_OK;
+}
+
+static CMD_STATUS ble_cmd_drops(CMD_ARG *arg){
+	char reply[BLE_STATS_SIZE];
+	uint32_t len;
+
+	len = format_str(reply, "drop new ");
+	len += format_uint(reply + len, drop_stats.dropped_newest);
+	len += format_str(reply + len, " old ");
+	len += format_uint(reply + len, drop_stats.dropped_oldest);
+	len += format_str(reply + len, " over ");
+	len += format_uint(reply + len, drop_stats.overwritten_telemetry);
+	len += format_str(reply + len, " block ");
+	len += format_uint(reply + len, drop_stats.block_timeouts);
+	format_str(reply + len, "\n");
+	ble_reply(reply);
+	return CMD_OK;
+}
+
+static CMD_STATUS ble_cmd_lanes(CMD_ARG *arg){
+	static const char *names[BLE_LANES] = { "alert", "bulk" };
+	char reply[BLE_STATS_SIZE];
+	BLE_LANE_STATS *stats;
+	uint32_t len;
+
+	for(int lane = 0; lane < BLE_LANES; lane++){
+		stats = &lane_stats[lane];
+		len = format_str(reply, names[lane]);
+		len += format_str(reply + len, " n ");
+		len += format_uint(reply + len, stats->messages);
+		len += format_str(reply + len, " avg ");
+		len += format_uint(reply + len, stats->messages ? stats->latency_sum / stats->messages : 0);
+		len += format_str(reply + len, " max ");
+		len += format_uint(reply + len, stats->latency_max);
+		len += format_str(reply + len, " passed ");
+		len += format_uint(reply + len, stats->passed);
+		format_str(reply + len, "\n");
+		ble_reply(reply);
+	}
+	return CMD_OK;
+}
+
+static CMD_STATUS ble_cmd_sleep(CMD_ARG *arg){
+	ble_module_sleep(arg->value);
+	return CMD_OK;
+}
+
+static CMD_STATUS ble_cmd_auto_sleep(CMD_ARG *arg){
+	return ble_module_auto_sleep(arg->value) ? CMD_OK : CMD_ERROR;
+}
+
+static CMD_STATUS ble_cmd_baud(CMD_ARG *arg){
+	return ble_set_baud(arg->value) ? CMD_OK : CMD_ERROR;
+}
+
+static CMD_STATUS ble_cmd_disconnect(CMD_ARG *arg){
+	ble_set_disconnect_policy(arg->value);
+	return CMD_OK;
+}
+
+static CMD_STATUS ble_cmd_conn(CMD_ARG *arg){
+	char reply[BLE_STATS_SIZE];
+	uint32_t len;
+
+	len = format_str(reply, "conn ");
+	len += format_uint(reply + len, conn_stats.connects);
+	len += format_str(reply + len, " lost ");
+	len += format_uint(reply + len, conn_stats.disconnects);
+	len += format_str(reply + len, " supp ");
+	len += format_uint(reply + len, conn_stats.suppressed);
+	len += format_str(reply + len, " sleep ");
+	len += format_uint(reply + len, conn_stats.module_sleeps);
+	len += format_str(reply + len, " wake ");
+	len += format_uint(reply + len, conn_stats.module_wakes);
+	format_str(reply + len, "\n");
+	ble_reply(reply);
+	return CMD_OK;
+}
+
+static const CMD_ENTRY ble_commands[] = {
+	{ CELSIUS_MESSAGE,		CMD_ARG_NONE, 0, 0, ble_cmd_celsius },
+	{ FAHRENHEIT_MESSAGE,	CMD_ARG_NONE, 0, 0, ble_cmd_fahrenheit },
+	{ BINARY_MESSAGE,		CMD_ARG_NONE, 0, 0, ble_cmd_binary },
+	{ TEXT_MESSAGE,			CMD_ARG_NONE, 0, 0, ble_cmd_text },
+	{ FAST_LINK_MESSAGE,	CMD_ARG_INT,  0, 1, ble_cmd_fast_link },
+	{ OVERFLOW_MESSAGE,		CMD_ARG_INT,  BLE_OVERFLOW_DROP_NEWEST, BLE_OVERFLOW_BLOCK, ble_cmd_overflow },
+	{ DROPS_MESSAGE,		CMD_ARG_NONE, 0, 0, ble_cmd_drops },
+	{ LANES_MESSAGE,		CMD_ARG_NONE, 0, 0, ble_cmd_lanes },
+	{ DISCONNECT_MESSAGE,	CMD_ARG_INT,  BLE_DISCONNECT_DROP, BLE_DISCONNECT_BUFFER, ble_cmd_disconnect },
+	{ CONN_MESSAGE,			CMD_ARG_NONE, 0, 0, ble_cmd_conn },
+	{ SLEEP_MESSAGE,		CMD_ARG_INT,  0, 1, ble_cmd_sleep },
+	{ AUTO_SLEEP_MESSAGE,	CMD_ARG_INT,  0, 1, ble_cmd_auto_sleep },
+	{ BAUD_MESSAGE,			CMD_ARG_INT,  CONFIG_BAUD_MIN, CONFIG_BAUD_MAX, ble_cmd_baud },
+};
+
+/***************************************************************************//**
+ * @brief
+ * Runs a command received from the phone, in either protocol, through the command table.
+ *
+ * @details
+ * A command that is unknown, has a bad argument or fails is answered with an error reply
+ * naming the command.  Successful commands are not answered.
+ *
+ * @param[in] *message
+ * The NUL terminated command.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ ******************************************************************************/
+static void ble_command(char *message){
+	char reply[BLE_REPLY_SIZE];
+	CMD_STATUS status;
+
+	status = command_dispatch(message);
+	if(status == CMD_OK) return;
+	if(status == CMD_UNKNOWN){
+		strcpy(reply, CMD_UNKNOWN_REPLY);
+	}
+	else if(status == CMD_BAD_ARG){
+		strcpy(reply, CMD_BAD_ARG_REPLY);
+	}
+	else{
+		strcpy(reply, CMD_ERROR_REPLY);
+	}
+	strncat(reply, message, BLE_REPLY_SIZE - strlen(reply) - 2);
+	strcat(reply, "\n");
+	ble_reply(reply);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Checks a received binary frame and passes a command frame on to ble_command().
+ *
+ * @details
+ * The COBS block is decoded, the length field is compared against the decoded size and
+ * the CRC is recomputed with the GPCRC.  Frames that fail either check are counted and
+ * dropped.
+ *
+ * @param[in] *message
+ * The received COBS block with the delimiter replaced by a NUL.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ ******************************************************************************/
+static void ble_frame_receive(char *message){
+	uint8_t frame[LEUART_MSG_SIZE];
+	uint32_t frame_len;
+	uint16_t crc;
+
+	if(!cobs_decode((uint8_t *)message, strlen(message), frame, &frame_len)
+			|| frame_len < BLE_FRAME_HEADER + BLE_FRAME_CRC
+			|| frame[1] != frame_len - BLE_FRAME_HEADER - BLE_FRAME_CRC){
+		frame_stats.framing_errors++;
+		return;
+	}
+	crc = (frame[frame_len - 2] << 8) | frame[frame_len - 1];
+	if(crc != gpcrc_crc16(frame, frame_len - BLE_FRAME_CRC)){
+		frame_stats.crc_errors++;
+		return;
+	}
+	frame_stats.rx_frames++;
+	if(frame[0] == BLE_FRAME_CMD){
+		frame[frame_len - BLE_FRAME_CRC] = 0;
+		ble_command((char *)&frame[BLE_FRAME_HEADER]);
+	}
+}
 
 //***********************************************************************************
 // Global functions
@@ -111,10 +987,12 @@ static void update_circ_readindex(BLE_CIRCULAR_BUF *index_struct, uint32_t updat
  *	This function sets up all necessary values for the bluetooth peripheral setup.
  *
  * @details
- * This passes in all of the correct values to the struct that then gets passed in to the leuart_open function
+ * This passes in all of the correct values to the struct that then gets passed in to the leuart_open function.
+ * The HM10 connection notifications are turned on with the AT command engine and watched for by the LEUART.
+ * If the HM10 was left at the fast rate, it is first looked for at both rates, see ble_transport_probe().
  *
  * @note
- * This function should only be called once in setup of the device.
+ * This function should only be called once in setup of the device, after command_open().
  *
  *@param[in] tx_event
  * This passes in the event that should be flagged in the event handler when the bluetooth has finished transmitting
@@ -122,12 +1000,15 @@ static void update_circ_readindex(BLE_CIRCULAR_BUF *index_struct, uint32_t updat
  *@param[in] rx_event
  *This passes in the event that should be flagged in the event handler when the bluetooth has received a transmission.
  *
+ *@param[in] at_event
+ * This passes in the event that should be flagged in the event handler when a run of AT commands has finished.
+ *
  ******************************************************************************/
 
-void ble_open(uint32_t tx_event, uint32_t rx_event){
+void ble_open(uint32_t tx_event, uint32_t rx_event, uint32_t at_event){
 
 	LEUART_OPEN_STRUCT open_leuart;
-	open_leuart.baudrate = HM10_BAUDRATE;
+	open_leuart.baudrate = config_get(CONFIG_BAUD);
 	open_leuart.databits = HM10_DATABITS;
 	open_leuart.enable = HM10_ENABLE;
 	open_leuart.parity = HM10_PARITY;
@@ -142,9 +1023,46 @@ void ble_open(uint32_t tx_event, uint32_t rx_event){
 	open_leuart.rx_pin_en = true;
 	open_leuart.tx_pin_en = true;
 
-	is_celsius = false;
+	is_celsius = config_get(CONFIG_CELSIUS);
+	transport = BLE_TRANSPORT_LEUART;
+	transport_pending = BLE_TRANSPORT_LEUART;
+	transport_auto = false;
+	transport_settling = false;
+	transport_probe = false;
+	baud_request = 0;
+	baud_queued = false;
+	ble_tx_event = tx_event;
+	ble_rx_event = rx_event;
+	ble_at_event = at_event;
+	at_count = 0;
+	at_sent = false;
+	at_status = BLE_AT_IDLE;
+	connected = true;		// until the HM10 shows otherwise, as before the state was tracked
+	disconnect_policy = BLE_DISCONNECT_DEFAULT;
+	module_state = BLE_MODULE_AWAKE;
+	module_sleep = BLE_MODULE_SLEEP_DEFAULT;
+	module_auto_sleep = false;
+	auto_sleep_pending = false;
+	sleep_retry = true;
+	memset(hm10_wake, HM10_WAKE_CHAR, HM10_WAKE_LEN);
+	protocol = BLE_PROTOCOL_TEXT;
+	overflow_policy = BLE_OVERFLOW_DEFAULT;
+	for(int i = 0; i < sizeof(ble_commands) / sizeof(ble_commands[0]); i++){
+		command_register(&ble_commands[i]);
+	}
+	gpcrc_open();
 	leuart_open(HM10_LEUART0, &open_leuart);
+	leuart_rx_watch(HM10_LEUART0, HM10_CONN_NOTE);
+	leuart_rx_watch(HM10_LEUART0, HM10_LOST_NOTE);
 	ble_circ_init();
+	if(config_get(CONFIG_HM10_FAST)){
+		transport_probe = true;		// the HM10 may still be at the fast rate, AT+NOTI1 is sent once it is found
+		probe_tries = 0;
+		ble_transport_probe();
+	}
+	else{
+		ble_at_queue(HM10_NOTI_CMD, HM10_NOTI_RESP, BLE_AT_TIMEOUT);	// answered only if no central is connected
+	}
 }
 
 /***************************************************************************//**
@@ -166,215 +1084,69 @@ void ble_open(uint32_t tx_event, uint32_t rx_event){
 void ble_write(char* string){
 	ble_circ_push(string);
 	ble_circ_pop(CIRC_OPER);
-//	leuart_start(HM10_LEUART0, string, strlen(string));
+//	leuart_start(HM10_LEUART0, string, strlen(string));
+}
+
+/***************************************************************************//**
+ * @brief
+ * Sends an alert to the phone ahead of any queued telemetry.
+ *
+ * @details
+ * The alert is queued on the alert lane, which is sent before the bulk lane, so it only waits
+ * for the transfer already in progress.  In the binary protocol it is sent as a BLE_FRAME_ALERT frame.
+ *
+ *@param[in] *string
+ * The NUL terminated alert, at most BLE_FRAME_MAX_PAYLOAD characters.
+ *
+ *******************************************************************************/
+void ble_write_alert(char *string){
+	if(protocol == BLE_PROTOCOL_BINARY){
+		ble_write_frame(BLE_FRAME_ALERT, (uint8_t *)string, strlen(string));
+		return;
+	}
+	ble_circ_push_bytes(string, strlen(string), BLE_MSG_ALERT);
+	ble_circ_pop(CIRC_OPER);
 }
 
 /***************************************************************************//**
  * @brief
- *   BLE Test performs two functions.  First, it is a Test Driven Development
- *   routine to verify that the LEUART is correctly configured to communicate
- *   with the BLE HM-18 module.  Second, the input argument passed to this
- *   function will be written into the BLE module and become the new name
- *   advertised by the module while it is looking to pair.
+ * Reserves space on the circular buffer for a message the caller formats in place.
  *
  * @details
- * 	 This global function will use polling functions provided by the LEUART
- * 	 driver for both transmit and receive to validate communications with
- * 	 the HM-18 BLE module.  For the assignment, the communication with the
- * 	 BLE module must use low energy design principles of being an interrupt
- * 	 driven state machine.
+ * Together with ble_commit() this lets a message be written straight into the circular buffer
+ * and transmitted from there, without the copies made by ble_write().
  *
  * @note
- *   For this test to run to completion, the phone most not be paired with
- *   the BLE module.  In addition for the name to be stored into the module
- *   a breakpoint must be placed at the end of the test routine and stopped
- *   at this breakpoint while in the debugger for a minimum of 5 seconds.
+ * The message must not be longer than half of the lane size, less the record header and
+ * BLE_STAMP_SIZE.  Only one reservation may be open.
  *
- * @param[in] *mod_name
- *   The name that will be written to the HM-18 BLE module to identify it
- *   while it is advertising over Bluetooth Low Energy.
+ *@param[in] len
+ * The largest number of characters that will be written, including a NUL terminator.
  *
- * @return
- *   Returns bool true if successfully passed through the tests in this
- *   function.
- ******************************************************************************/
-
-bool ble_test(char *mod_name){
-	uint32_t	str_len;
-
-	__disable_irq();
-	// This test will limit the test to the proper setup of the LEUART
-	// peripheral, routing of the signals to the proper pins, pin
-	// configuration, and transmit/reception verification.  The test
-	// will communicate with the BLE module using polling routines
-	// instead of interrupts.
-	// How is polling different than using interrupts?
-
-	// ANSWER: polling requires the processor to constantly check a resource
-	//taking power and removing time from other processes, while an interrupt wakes up the processor when a resource is available
-
-	// How does interrupts benefit the system for low energy operation?
-
-	// ANSWER: They allow the processor the ability to go completely to sleep. This turns off all the required power
-	// of the processor. Therefore the process can operate for a longer time with less energy.
-
-	// How does interrupts benefit the system that has multiple tasks?
-
-	// ANSWER: The interrupts benefit the system if it has multiple tasks because this allows for multiple interrupts
-	// which can wake up the processor at different times to react quickly to various events without having to wait for
-	// other events to finish or the need to poll to check for resources.
-
-	// First, you will need to review the DSD HM10 datasheet to determine
-	// what the default strings to write data to the BLE module and the
-	// expected return statement from the BLE module to test / verify the
-	// correct response
-
-	// The break_str is used to tell the BLE module to end a Bluetooth connection
-	// such as with your phone.  The ok_str is the result sent from the BLE module
-	// to the micro-controller if there was not active BLE connection at the time
-	// the break command was sent to the BLE module.
-	// Replace the break_str "" with the command to break or end a BLE connection
-	// Replace the ok_str "" with the result that will be returned from the BLE
-	//   module if there was no BLE connection
-	char		break_str[80] = "AT";
-	char		ok_str[80] = "OK";
-
-	// output_str will be the string that will program a name to the BLE module.
-	// From the DSD HM10 datasheet, what is the command to program a name into
-	// the BLE module?
-	// The  output_str will be a string concatenation of the DSD HM10 command
-	// and the input argument sent to the ble_test() function
-	// Replace the otput_str "" with the command to change the program name
-	// Replace the result_str "" with the first part of the expected result
-	//  the backend of the expected response will be concatenated with the
-	//  input argument
-	char		output_str[80] = "AT+Name";
-	char		result_str[80] = "OK+Set:";
-
-	// To program the name into your module, you must reset the module after you
-	// have sent the command to update the modules name.  What is the DSD HM10
-	// name to reset the module?
-	// Replace the reset_str "" with the command to reset the module
-	// Replace the reset_result_str "" with the expected BLE module response to
-	//  to the reset command
-	char		reset_str[80] = "AT+RESET";
-	char		reset_result_str[80] = "OK+RESET";
-	char		return_str[80];
-
-	bool		success;
-	bool		rx_disabled, rx_en, tx_en;
-	uint32_t	status;
-
-	// These are the routines that will build up the entire command and response
-	// of programming the name into the BLE module.  Concatenating the command or
-	// response with the input argument name
-	strcat(output_str, mod_name);
-	strcat(result_str, mod_name);
-
-	// The test routine must not alter the function of the configuration of the
-	// LEUART driver, but requires certain functionality to insure the logical test
-	// of writing and reading to the DSD HM10 module.  The following c-lines of code
-	// save the current state of the LEUART driver that will be used later to
-	// re-instate the LEUART configuration
-
-	status = leuart_status(HM10_LEUART0);
-	if (status & LEUART_STATUS_RXBLOCK) {
-		rx_disabled = true;
-		// Enabling, unblocking, the receiving of data from the LEUART RX port
-		leuart_cmd_write(HM10_LEUART0, LEUART_CMD_RXBLOCKDIS);
-	}
-	else rx_disabled = false;
-	if (status & LEUART_STATUS_RXENS) {
-		rx_en = true;
-	} else {
-		rx_en = false;
-		// Enabling the receiving of data from the RX port
-		leuart_cmd_write(HM10_LEUART0, LEUART_CMD_RXEN);
-		while (!(leuart_status(HM10_LEUART0) & LEUART_STATUS_RXENS));
-	}
-
-	if (status & LEUART_STATUS_TXENS){
-		tx_en = true;
-	} else {
-		// Enabling the transmission of data to the TX port
-		leuart_cmd_write(HM10_LEUART0, LEUART_CMD_TXEN);
-		while (!(leuart_status(HM10_LEUART0) & LEUART_STATUS_TXENS));
-		tx_en = false;
-	}
-//    leuart_cmd_write(HM10_LEUART0, (LEUART_CMD_CLEARRX | LEUART_CMD_CLEARTX));
-
-	// This sequence of instructions is sending the break ble connection
-	// to the DSD HM10 module.
-
-	// Why is this command required if you want to change the name of the
-	// DSD HM10 module?
-
-	// ANSWER: It is required because if you want to change the name you must send the command
-	// to correctly tell the bluetooth chip to change the name using the proper protocol.
-	str_len = strlen(break_str);
-	for (int i = 0; i < str_len; i++){
-		leuart_app_transmit_byte(HM10_LEUART0, break_str[i]);
-	}
-
-	// What will the ble module response back to this command if there is
-	// a current ble connection?
-
-	// ANSWER: There will be no response if there is already a connection between the ports.
-
-	str_len = strlen(ok_str);
-	for (int i = 0; i < str_len; i++){
-		return_str[i] = leuart_app_receive_byte(HM10_LEUART0);
-		if (ok_str[i] != return_str[i]) {
-				EFM_ASSERT(false);;
-		}
-	}
-
-	// This sequence of code will be writing or programming the name of
-	// the module to the DSD HM10
-	str_len = strlen(output_str);
-	for (int i = 0; i < str_len; i++){
-		leuart_app_transmit_byte(HM10_LEUART0, output_str[i]);
-	}
-
-	// Here will be the check on the response back from the DSD HM10 on the
-	// programming of its name
-	str_len = strlen(result_str);
-	for (int i = 0; i < str_len; i++){
-		return_str[i] = leuart_app_receive_byte(HM10_LEUART0);
-		if (result_str[i] != return_str[i]) {
-			EFM_ASSERT(false);
-		}
-	}
-
-	// It is now time to send the command to RESET the DSD HM10 module
-	str_len = strlen(reset_str);
-	for (int i = 0; i < str_len; i++){
-		leuart_app_transmit_byte(HM10_LEUART0, reset_str[i]);
-	}
-
-	// After sending the command to RESET, the DSD HM10 will send a response
-	// back to the micro-controller
-	str_len = strlen(reset_result_str);
-	for (int i = 0; i < str_len; i++){
-		return_str[i] = leuart_app_receive_byte(HM10_LEUART0);
-		if (reset_result_str[i] != return_str[i]) {
-				EFM_ASSERT(false);;
-		}
-	}
-
-	// After the test and programming have been completed, the original
-	// state of the LEUART must be restored
-	if (!rx_en) leuart_cmd_write(HM10_LEUART0, LEUART_CMD_RXDIS);
-	if (rx_disabled) leuart_cmd_write(HM10_LEUART0, LEUART_CMD_RXBLOCKEN);
-	if (!tx_en) leuart_cmd_write(HM10_LEUART0, LEUART_CMD_TXDIS);
-	leuart_if_reset(HM10_LEUART0);
-
-	success = true;
-
-	__enable_irq();
-	return success;
+ *@param[in] msg_class
+ * Whether the message is telemetry or an alert, used by the overflow policy.
+ *
+ *@return
+ * The address in the circular buffer to write the message to, or NULL if the overflow
+ * policy dropped the message.  ble_commit() must not be called after NULL.
+ *
+ *******************************************************************************/
+char *ble_reserve(uint32_t len, BLE_MSG_CLASS msg_class){
+	return ble_circ_reserve(len, msg_class);
 }
 
+/***************************************************************************//**
+ * @brief
+ * Queues the message written into the space returned by ble_reserve().
+ *
+ *@param[in] len
+ * The number of characters to send, not counting a NUL terminator.
+ *
+ *******************************************************************************/
+void ble_commit(uint32_t len){
+	ble_circ_commit(len);
+	ble_circ_pop(CIRC_OPER);
+}
 
 /***************************************************************************//**
  * @brief
@@ -400,8 +1172,7 @@ void circular_buff_test(void){
 	 // Why this 0 initialize of read and write pointer?
 	 // Student Response:
 	 // This makes it so that the circular buffer starts empty, both starting at the 0th index of the array.
-	 ble_cbuf.read_ptr = 0;
-	 ble_cbuf.write_ptr = 0;
+	 ble_circ_init();
 
 	 // Why do none of these test strings contain a 0?
 	 // Student Response:
@@ -482,8 +1253,8 @@ void circular_buff_test(void){
 
 /***************************************************************************//**
  * @brief
- * This function initializes the circular buffer to have the read and write pointer
- * values equal to 0, as well as the size of the buffer equal to the defined macro.
+ * This function initializes both lanes of the circular buffer to have the read and write pointer
+ * values equal to 0.  The sizes of the lanes are the compile time BLE_ALERT_CIRC_SIZE and BLE_CIRC_SIZE.
  *
  * @details
  * This function only has to initialize the values of the circular buffer private struct.
@@ -493,10 +1264,10 @@ void circular_buff_test(void){
  ******************************************************************************/
 
 void ble_circ_init(void){
-ble_cbuf.read_ptr = 0;
-ble_cbuf.write_ptr = 0;
-ble_cbuf.size = CSIZE;
-ble_cbuf.size_mask = 0; // unknown yet
+spsc_ring_init(&ble_lanes[BLE_LANE_ALERT], ble_alert_storage, BLE_ALERT_CIRC_SIZE);
+spsc_ring_init(&ble_lanes[BLE_LANE_BULK], ble_bulk_storage, BLE_CIRC_SIZE);
+ble_tx_in_flight = 0;
+alert_streak = 0;
 }
 
 /***************************************************************************//**
@@ -504,9 +1275,8 @@ ble_cbuf.size_mask = 0; // unknown yet
  * This function pushes a string onto the circular buffer.
  *
  * @details
- * This calculates the packet size and then after checking if the packet will fit,
- * it loops through putting the packet on the buffer, and then it updates the write
- * pointer to the new start of the empty space on the circular buffer.
+ * The string is pushed without its NUL terminator; the packet size stored in front of
+ * it is used to find the end of the string when it is popped.
  *
  * @param[in] *string
  * The character array of the message that is being sent to the circular buffer.
@@ -516,15 +1286,7 @@ ble_cbuf.size_mask = 0; // unknown yet
  *	until the transmission has finished on the leuart.
  ******************************************************************************/
 void ble_circ_push(char *string){
-uint8_t packet_size = strlen(string)+1;
-if(packet_size > ble_circ_space()) EFM_ASSERT(false);
-
-ble_cbuf.cbuf[ble_cbuf.write_ptr] = packet_size;
-
-for(int i= 1; i < packet_size; i++){
-	ble_cbuf.cbuf[(ble_cbuf.write_ptr+i)%ble_cbuf.size] = string[i-1];
-}
-update_circ_wrtindex(&ble_cbuf, packet_size);
+	ble_circ_push_bytes(string, strlen(string), BLE_MSG_TELEMETRY);
 }
 
 /***************************************************************************//**
@@ -533,13 +1295,19 @@ update_circ_wrtindex(&ble_cbuf, packet_size);
  * to a struct, or sends it to the LEUART.
  *
  * @details
- * This function loops through and pulls off information from the buffer, after making sure there
- * is something to remove and the LEUART isn't busy. Once this happens it sends the string to the LEUART to be written,
- * and it updates the read pointer.
+ * This function pulls off information from the buffer, after making sure there is something to remove
+ * and the LEUART isn't busy. The alert lane is served before the bulk lane, see ble_circ_lane(). All queued
+ * strings of the lane, up to BLE_TX_BURST characters and TX_MAX_SEGMENTS strings, are sent as one transfer
+ * with a single tx done event. The LEUART transmits the strings straight from the
+ * buffer, so they are only removed from the buffer by the next call once the transmission is done.
+ * While the AT command engine runs nothing is sent from the buffer, since the HM10 would read it as commands,
+ * and nothing is sent while no central is connected or while the HM10 restarts after a transport switch.
+ * The transport is only picked while no central is connected, see ble_transport_select().
  *
  * @param[in] test
  * Specifies if this is a test of the function, or if it is the function in operation. If false the popped string will be
- * sent to the LEUART to be transmitted
+ * sent to the LEUART to be transmitted.  A test pop does not look at the transmitter, so it works while AT commands
+ * are being sent, but nothing may be in flight from the buffer.
  *
  * @return
  * returns true if nothing is popped from the buffer and false if something is removed from the buffer.
@@ -549,29 +1317,58 @@ update_circ_wrtindex(&ble_cbuf, packet_size);
  *	as well as it is called to check if there is information for the LEUART to send once the LEUART finishes a transmission.
  ******************************************************************************/
 bool ble_circ_pop(bool test){
-uint8_t filled = ble_cbuf.size - ble_circ_space() ;
-if(filled == 0)return true; //Empty circular buffer
-if(leuart_tx_busy(HM10_LEUART0))return true;
-uint8_t string_length = ble_cbuf.cbuf[ble_cbuf.read_ptr] - 1;
-if(string_length + 1 > filled) EFM_ASSERT(false); //Guaranteed string mismatch
-char print_str[ble_cbuf.size];
-for(int i = 0; i < string_length; i++){
-	print_str[i] = ble_cbuf.cbuf[(ble_cbuf.read_ptr+1+i)% ble_cbuf.size];
-}
-print_str[string_length] = 0;//adds null to signify end of string
-update_circ_readindex(&ble_cbuf, string_length + 1);
+uint32_t filled;
+uint32_t string_length;
+char *string;
+TX_SEGMENT segments[TX_MAX_SEGMENTS];
+uint32_t offset = 0;
+uint32_t burst = 0;
+BLE_LANE lane;
+if(!test){ //the test only uses the buffer and leaves the transmitter alone
+	if(ble_tx_busy())return true;
+	ble_circ_release(); //the message that was sent straight from the buffer is done
+}
+if(!test && transport_settling){ //the HM10 is restarting at the new baud rate, see ble_at_poll()
+	return true;
+}
+if(!test && at_count > 0){ //AT commands are sent first and hold the buffer until they are answered
+	if(!at_sent) ble_at_send();
+	return true;
+}
+if(!test && !connected){ //nothing is sent until a central connects, the transport stays idle
+	ble_transport_select();
+	return true;
+}
+filled = spsc_ring_count(&ble_lanes[BLE_LANE_ALERT]) + spsc_ring_count(&ble_lanes[BLE_LANE_BULK]);
+if(filled == 0){ //Empty circular buffer
+	return true;
+}
+lane = ble_circ_lane();
 if(test){
+	EFM_ASSERT(ble_tx_in_flight == 0); //the transmitter must not be reading the buffer
+	string = spsc_ring_peek_record(&ble_lanes[lane], &string_length, NULL);
+	string_length -= BLE_STAMP_SIZE;
 	for (int i = 0; i < string_length; i++){
-		test_struct.result_str[i] = print_str[i];
+		test_struct.result_str[i] = string[BLE_STAMP_SIZE + i];
 	}
+	spsc_ring_consume_record(&ble_lanes[lane]);
 	return false;
 }
 else{
-	leuart_start(HM10_LEUART0, print_str, strlen(print_str));
-//	ble_write(print_str);
+	//every queued message of the lane that fits in the burst is sent as one transfer
+	ble_tx_lane = lane;
+	while(ble_tx_in_flight < TX_MAX_SEGMENTS
+			&& (string = spsc_ring_peek_next(&ble_lanes[lane], &offset, &string_length, NULL)) != NULL){
+		string_length -= BLE_STAMP_SIZE;
+		if(ble_tx_in_flight > 0 && burst + string_length > BLE_TX_BURST) break;
+		segments[ble_tx_in_flight].data = string + BLE_STAMP_SIZE;
+		segments[ble_tx_in_flight].len = string_length;
+		ble_tx_in_flight++;
+		burst += string_length;
+	}
+	ble_tx_start(segments, ble_tx_in_flight);
 	return false;
 }
-
 }
 
 /***************************************************************************//**
@@ -595,8 +1392,12 @@ bool ble_mode_celsius(void){
  *	This function is meant to update a private variable storing the ble settings for Celsius of Fahrenheit.
  *
  * @details
- *	This function uses string compare to determine if the value stored in the rxmessage array is the same as
- *	either "Celsius" or "Fahrenheit". If neither, it does not change the current mode.
+ *	Every message waiting on the RX queue is handled, since the ISR may have queued more than one
+ *	before the event was serviced.  OK+CONN and OK+LOST notifications update the connection state.
+ *	While AT commands are queued the received characters are responses for the AT command engine.  In the text protocol the received message is passed to the command dispatcher.  In the binary
+ *	protocol the message is first checked as a frame and only a command frame with a valid CRC is dispatched.
+ *	"Celsius" or "Fahrenheit" select the units and "Binary" or "Text" select the protocol; other modules
+ *	add their own commands to the table.
  *
  * @note
  *	This function doesn't return anything, it just updates if the mode is Celsius or not. This data is returned
@@ -604,16 +1405,526 @@ bool ble_mode_celsius(void){
  *
  ******************************************************************************/
 void ble_update_mode(void){
-	char * message;
-	char celsius[16]= CELSIUS_MESSAGE;
-	char farenheit[16] = FAHRENHEIT_MESSAGE;
-	message = leuart_rxmessage();
-	if(strcmp(celsius, message) == 0){
-		is_celsius = true;
+	char message[LEUART_MSG_SIZE];
+	while(ble_rx_message(message)){
+		if(ble_notification(message)){
+			continue;
+		}
+		if(at_count > 0){
+			ble_at_receive(message);
+		}
+		else if(protocol == BLE_PROTOCOL_BINARY){
+			ble_frame_receive(message);
+		}
+		else{
+			ble_command(message);
+		}
+	}
+	ble_at_poll();
+}
+
+
+/***************************************************************************//**
+ * @brief
+ *	Moves the link to the HM10 between the low energy LEUART and the high-throughput USART.
+ *
+ * @details
+ *	The HM10 baud rate is negotiated at runtime with the AT command engine: AT+BAUD selects the
+ *	new rate and AT+RESET restarts the module so the new rate takes effect.  Only after both
+ *	commands are acknowledged are the pins handed from one peripheral to the other, and nothing
+ *	is sent for HM10_RESET_DELAY ms while the HM10 restarts.  If either command times out after
+ *	BLE_AT_TIMEOUT ms the current transport is kept.  The at_event given to ble_open() is
+ *	scheduled when the switch ends, and ble_transport() returns the transport in use.  The
+ *	interrupts stay enabled and the CPU sleeps while the HM10 answers.
+ *
+ *	The USART watches for the OK+CONN and OK+LOST notifications and answers the AT command
+ *	engine the same as the LEUART, so the connection state stays current on either transport.
+ *
+ * @note
+ *	The LEUART keeps the device in EM3 between transmissions, while the USART requires EM1 for
+ *	as long as it is open.  The HM10 only answers AT commands while no central is connected,
+ *	so the switch is refused while one is.  The HM10 keeps its baud rate across an MCU reset, so
+ *	a switch to the USART is recorded in the config first, and ble_open() looks for the module
+ *	at both rates until it is back on the LEUART.
+ *
+ * @param[in] new_transport
+ *	The transport to switch to.
+ *
+ * @return
+ *	false if the switch could not be started: a central is connected, or AT commands or another
+ *	switch are in progress.
+ ******************************************************************************/
+bool ble_set_transport(BLE_TRANSPORT new_transport){
+	if(new_transport == transport) return true;
+	if(connected || at_count > 0 || transport_settling || transport_probe || transport_pending != transport) return false;
+	if(new_transport == BLE_TRANSPORT_USART){
+		config_set(CONFIG_HM10_FAST, true);		// before the HM10 can change, so a reset looks for it
+	}
+	return ble_transport_queue(new_transport);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Returns the transport currently used to talk to the HM10.
+ *
+ ******************************************************************************/
+BLE_TRANSPORT ble_transport(void){
+	return transport;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Changes the baud rate of the LEUART link to the HM10.
+ *
+ * @details
+ *	The HM10 is moved first with AT+BAUD and AT+RESET, at the next disconnection while the link
+ *	is on the LEUART, and the LEUART and the CONFIG_BAUD value follow only once both commands
+ *	are answered.  A change the HM10 does not answer is dropped and the old rate kept, so the
+ *	stored rate always matches the module.  Set with the "Baud" command.
+ *
+ * @param[in] baud
+ *	The new rate, one of the rates in baud_codes[].
+ *
+ * @return
+ *	false if the HM10 does not support the rate, or a change is already being made.
+ ******************************************************************************/
+bool ble_set_baud(uint32_t baud){
+	bool supported = false;
+
+	for(int i = 0; i < sizeof(baud_codes) / sizeof(baud_codes[0]); i++){
+		if(baud_codes[i].baud == baud) supported = true;
+	}
+	if(!supported || baud_queued) return false;
+	baud_request = baud == config_get(CONFIG_BAUD) ? 0 : baud;
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Enables or disables the automatic switch to the fast transport for bulk transfers.
+ *
+ * @details
+ *	When enabled, the link moves to the USART while no central is connected once the flash log
+ *	or the circular buffer holds a backlog, so the backfill is sent at the fast baud rate when
+ *	one connects, and back to the LEUART once both have drained and the central has
+ *	disconnected, see ble_transport_select().  Turning it off moves the link back at the next
+ *	disconnection.  Set with the "Fastlink" command.  Off by default, since the USART keeps the
+ *	device in EM1 from the switch until the backlog has been sent.
+ *
+ * @param[in] enable
+ *	true to let the backlog pick the transport.
+ ******************************************************************************/
+void ble_transport_auto(bool enable){
+	transport_auto = enable;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Queues a binary frame for transmission to the phone.
+ *
+ * @details
+ *	The frame is built as type, length, payload and a CRC-16 computed by the GPCRC over the
+ *	type, length and payload.  The frame is COBS encoded straight into the circular buffer and
+ *	terminated by a 0x00 delimiter.  BLE_FRAME_ALERT frames are queued on the alert lane.
+ *
+ * @param[in] type
+ *	The frame type, one of the BLE_FRAME_ defines.
+ *
+ * @param[in] *payload
+ *	The payload bytes.
+ *
+ * @param[in] len
+ *	The number of payload bytes, at most BLE_FRAME_MAX_PAYLOAD.
+ ******************************************************************************/
+void ble_write_frame(uint8_t type, uint8_t *payload, uint32_t len){
+	uint8_t frame[BLE_FRAME_HEADER + BLE_FRAME_MAX_PAYLOAD + BLE_FRAME_CRC];
+	uint8_t *encoded;
+	uint32_t encoded_len;
+	uint16_t crc;
+
+	EFM_ASSERT(len <= BLE_FRAME_MAX_PAYLOAD);
+	frame[0] = type;
+	frame[1] = len;
+	memcpy(&frame[BLE_FRAME_HEADER], payload, len);
+	crc = gpcrc_crc16(frame, BLE_FRAME_HEADER + len);
+	frame[BLE_FRAME_HEADER + len] = crc >> 8;
+	frame[BLE_FRAME_HEADER + len + 1] = crc & 0xFF;
+
+	encoded = (uint8_t *)ble_reserve(COBS_MAX_ENCODED(BLE_FRAME_HEADER + len + BLE_FRAME_CRC) + 1,
+			type == BLE_FRAME_ALERT ? BLE_MSG_ALERT : BLE_MSG_TELEMETRY);
+	if(encoded == NULL) return;	//dropped by the overflow policy
+	encoded_len = cobs_encode(frame, BLE_FRAME_HEADER + len + BLE_FRAME_CRC, encoded);
+	encoded[encoded_len++] = COBS_DELIMITER;
+	frame_stats.tx_frames++;
+	ble_commit(encoded_len);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Selects the text or the binary framed protocol.
+ *
+ * @details
+ *	The receiver of the active transport is switched between start/signal frame reception
+ *	for text and 0x00 delimited reception for binary frames.
+ *
+ * @param[in] new_protocol
+ *	The protocol to use for messages in both directions.
+ ******************************************************************************/
+void ble_set_protocol(BLE_PROTOCOL new_protocol){
+	if(new_protocol == protocol) return;
+	protocol = new_protocol;
+	if(transport == BLE_TRANSPORT_USART){
+		usart_rx_delimited(HM10_USART, protocol == BLE_PROTOCOL_BINARY);
+	}
+	else{
+		leuart_rx_delimited(HM10_LEUART0, protocol == BLE_PROTOCOL_BINARY);
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Returns the protocol currently used with the phone.
+ *
+ ******************************************************************************/
+BLE_PROTOCOL ble_protocol(void){
+	return protocol;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Copies the binary frame counters, including the integrity failures.
+ *
+ * @param[out] *stats
+ *	The struct the counters are copied into.
+ ******************************************************************************/
+void ble_frame_stats(BLE_FRAME_STATS *stats){
+	*stats = frame_stats;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Sends a reply to a command in the protocol currently in use.
+ *
+ * @param[in] *reply
+ *	The NUL terminated reply.  In the binary protocol only the first BLE_FRAME_MAX_PAYLOAD
+ *	characters are sent.
+ ******************************************************************************/
+void ble_reply(char *reply){
+	uint32_t len = strlen(reply);
+
+	if(protocol == BLE_PROTOCOL_BINARY){
+		ble_write_frame(BLE_FRAME_REPLY, (uint8_t *)reply, len < BLE_FRAME_MAX_PAYLOAD ? len : BLE_FRAME_MAX_PAYLOAD);
+	}
+	else{
+		ble_write(reply);
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Selects what happens to a message that does not fit on the circular buffer.
+ *
+ * @details
+ *	Set with the "Overflow" command, and the counters are replied to the "Drops" command.
+ *
+ * @param[in] policy
+ *	One of the BLE_OVERFLOW_ policies, see ble_circ_reserve().
+ ******************************************************************************/
+void ble_set_overflow_policy(BLE_OVERFLOW_POLICY policy){
+	overflow_policy = policy;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Copies the counters of messages lost to the overflow policy.
+ *
+ * @param[out] *stats
+ *	The struct the counters are copied into.
+ ******************************************************************************/
+void ble_drop_stats(BLE_DROP_STATS *stats){
+	*stats = drop_stats;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Copies the message count and queue latency of one lane of the circular buffer.
+ *
+ * @details
+ *	The latency of a message is measured from ble_commit() to the end of its transmission.
+ *	The counters of both lanes are replied to the "Lanes" command, latency in ms.
+ *
+ * @param[in] lane
+ *	The lane to report.
+ *
+ * @param[out] *stats
+ *	The struct the counters are copied into.
+ ******************************************************************************/
+void ble_lane_stats(BLE_LANE lane, BLE_LANE_STATS *stats){
+	EFM_ASSERT(lane < BLE_LANES);
+	*stats = lane_stats[lane];
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Returns the free bytes of the bulk lane of the circular buffer.
+ *
+ * @details
+ *	Lets a producer of bulk data, such as the flash log backfill, wait for room instead of
+ *	having its messages dropped or overwritten by the overflow policy.  Each message also
+ *	takes a record header and the BLE_STAMP_SIZE timestamp.
+ ******************************************************************************/
+uint32_t ble_bulk_space(void){
+	return spsc_ring_space(&ble_lanes[BLE_LANE_BULK]);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Queues an AT command for the HM10 without blocking.
+ *
+ * @details
+ *	The command is sent as soon as the commands ahead of it have been answered and the transport
+ *	is free.  The response is matched by ble_update_mode() as the interrupt driven receiver
+ *	queues it, so the CPU sleeps while the HM10 answers.  When the last command is answered, or
+ *	one times out, the at_event given to ble_open() is scheduled and ble_at_status() holds the result.
+ *	Messages written while commands are queued wait on the circular buffer.  A sleeping module is
+ *	first woken with the wake string and its OK+WAKE answer.
+ *
+ * @note
+ *	The HM10 only answers AT commands while no central is connected.  The engine runs on either
+ *	transport, and no command is queued while a transport switch is in progress.
+ *
+ * @param[in] *cmd
+ *	The AT command, shorter than BLE_AT_CMD_SIZE.
+ *
+ * @param[in] *response
+ *	The response expected from the HM10, shorter than BLE_AT_CMD_SIZE.
+ *
+ * @param[in] timeout
+ *	ms to wait for the response.  A timeout is only noticed on the next rx or LETIMER UF event.
+ *
+ * @return
+ *	false if the command could not be queued.
+ ******************************************************************************/
+bool ble_at_queue(char *cmd, char *response, uint32_t timeout){
+	bool wake = at_count == 0 && module_state == BLE_MODULE_ASLEEP;
+
+	if(transport_pending != transport || BLE_AT_QUEUE_SIZE - at_count < 1 + wake) return false;
+	if(strlen(cmd) >= BLE_AT_CMD_SIZE || strlen(response) >= BLE_AT_CMD_SIZE) return false;
+	if(wake){
+		ble_at_push("", HM10_WAKE_RESP, BLE_AT_TIMEOUT, true);	// wake handshake first
+	}
+	ble_at_push(cmd, response, timeout, false);
+	ble_circ_pop(CIRC_OPER);
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Programs the advertised name of the HM10 with the AT command engine.
+ *
+ * @details
+ *	Queues AT, AT+Name and AT+RESET, the restart making the new name take effect.  The
+ *	interrupts stay enabled and the CPU sleeps while the HM10 answers, and the result is
+ *	reported through the at_event.
+ *
+ * @param[in] *mod_name
+ *	The name the HM10 advertises.
+ *
+ * @return
+ *	false if the commands could not be queued.
+ ******************************************************************************/
+bool ble_at_set_name(char *mod_name){
+	char cmd[BLE_AT_CMD_SIZE];
+	char response[BLE_AT_CMD_SIZE];
+
+	if(strlen(mod_name) + strlen(HM10_NAME_RESP) >= BLE_AT_CMD_SIZE) return false;
+	if(BLE_AT_QUEUE_SIZE - at_count < 4) return false;	// three commands and a wake handshake
+	strcpy(cmd, HM10_NAME_CMD);
+	strcat(cmd, mod_name);
+	strcpy(response, HM10_NAME_RESP);
+	strcat(response, mod_name);
+	return ble_at_queue(HM10_AT_CMD, HM10_AT_RESP, BLE_AT_TIMEOUT)
+		&& ble_at_queue(cmd, response, BLE_AT_TIMEOUT)
+		&& ble_at_queue(HM10_RESET_CMD, HM10_RESET_RESP, BLE_AT_TIMEOUT);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Checks the AT command in progress for a timeout.
+ *
+ * @details
+ *	Called from the LETIMER UF event, so a command that is never answered ends the run
+ *	instead of waiting forever.  The end of the HM10 restart after a transport switch is also
+ *	noticed here, and a baud rate change requested with ble_set_baud() is started once the
+ *	central has gone.  In step with the firmware's own sleep, the HM10 is also put
+ *	to sleep here once it is idle with no central connected.
+ ******************************************************************************/
+void ble_at_poll(void){
+	if(at_sent && (int32_t)(letimer_ms(BLE_AT_TIMER) - at_deadline) >= 0){
+		ble_at_finish(BLE_AT_TIMED_OUT);
+	}
+	if(transport_settling && (int32_t)(letimer_ms(BLE_AT_TIMER) - settle_deadline) >= 0){
+		transport_settling = false;
+		ble_circ_pop(CIRC_OPER);
+	}
+	if(!connected && !ble_tx_busy()){
+		ble_transport_select();		// the flash log grows while disconnected without touching the circular buffer
+	}
+	ble_baud_check();
+	ble_module_sleep_check();
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Returns the result of the last run of the AT command engine.
+ ******************************************************************************/
+BLE_AT_STATUS ble_at_status(void){
+	return at_status;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Returns if a central is connected to the HM10.
+ *
+ * @details
+ *	The state follows the OK+CONN and OK+LOST notifications.  An answered AT command also
+ *	shows that no central is connected.
+ ******************************************************************************/
+bool ble_connected(void){
+	return connected;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Selects what happens to messages written while no central is connected.
+ *
+ * @details
+ *	Set with the "Disconnect" command.
+ *
+ * @param[in] policy
+ *	BLE_DISCONNECT_DROP drops telemetry before it is formatted, BLE_DISCONNECT_BUFFER holds
+ *	it on the circular buffer until a central connects.
+ ******************************************************************************/
+void ble_set_disconnect_policy(BLE_DISCONNECT_POLICY policy){
+	disconnect_policy = policy;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Copies the connection counters, including the telemetry suppressed while disconnected.
+ *
+ * @details
+ *	The counters are also replied to the "Conn" command.
+ *
+ * @param[out] *stats
+ *	The struct the counters are copied into.
+ ******************************************************************************/
+void ble_conn_stats(BLE_CONN_STATS *stats){
+	*stats = conn_stats;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Turns the management of the HM10 sleep on or off.
+ *
+ * @details
+ *	With it on, the HM10 is put to sleep at the first LETIMER UF event where it is idle and no
+ *	central is connected.  Messages are held on the circular buffer while it sleeps, and it is
+ *	woken with the wake handshake before any AT command.  Turning it off wakes the module.
+ *	Set with the "Sleep" command, on by default with BLE_MODULE_SLEEP_DEFAULT.
+ *
+ * @param[in] enable
+ *	true to let the HM10 sleep.
+ ******************************************************************************/
+void ble_module_sleep(bool enable){
+	module_sleep = enable;
+	if(!enable && module_state == BLE_MODULE_ASLEEP){
+		ble_at_queue(HM10_AT_CMD, HM10_AT_RESP, BLE_AT_TIMEOUT);	// preceded by the wake handshake
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Selects if the HM10 puts itself to sleep while no central is connected.
+ *
+ * @details
+ *	AT+PWRM is queued followed by AT+RESET, since the setting takes effect after a restart.
+ *	With auto sleep on no AT+SLEEP is sent, the module is only marked as asleep.  The HM10
+ *	does not answer AT commands while a central is connected, so during a connection, as when
+ *	set with the "Autosleep" command from the phone, the change is made at the next
+ *	disconnection.
+ *
+ * @param[in] enable
+ *	true for AT+PWRM0, auto sleep, false for AT+PWRM1.
+ *
+ * @return
+ *	false if the commands could not be queued.
+ ******************************************************************************/
+bool ble_module_auto_sleep(bool enable){
+	if(connected){
+		auto_sleep_request = enable;
+		auto_sleep_pending = true;
+		return true;
 	}
-	else if(strcmp(farenheit, message) == 0) {
-		is_celsius = false;
+	if(transport_pending != transport || BLE_AT_QUEUE_SIZE - at_count < 3) return false;	// two commands and a wake handshake
+	auto_sleep_pending = false;
+	module_auto_sleep = enable;
+	if(enable){
+		return ble_at_queue(HM10_AUTO_SLEEP_CMD, HM10_AUTO_SLEEP_RESP, BLE_AT_TIMEOUT)
+			&& ble_at_queue(HM10_RESET_CMD, HM10_RESET_RESP, BLE_AT_TIMEOUT);
 	}
+	return ble_at_queue(HM10_NO_AUTO_SLEEP_CMD, HM10_NO_AUTO_SLEEP_RESP, BLE_AT_TIMEOUT)
+		&& ble_at_queue(HM10_RESET_CMD, HM10_RESET_RESP, BLE_AT_TIMEOUT);
 }
 
+/***************************************************************************//**
+ * @brief
+ *	Returns if the HM10 is awake or asleep.
+ ******************************************************************************/
+BLE_MODULE_STATE ble_module_state(void){
+	return module_state;
+}
 
+#ifdef BLE_BENCH_ENABLED
+/***************************************************************************//**
+ * @brief
+ *	Measures the throughput of the circular buffer push and pop.
+ *
+ * @details
+ *	A BLE_BENCH_MSG_LEN byte message is pushed and popped BLE_BENCH_ROUNDS times and the
+ *	core cycles of each operation are summed with the DWT cycle counter.  The result is
+ *	sent over BLE in bytes per 1000 cycles.
+ *
+ * @note
+ *	Waits for the transmitter to go idle, so it must be called while no other message is queued.
+ ******************************************************************************/
+void ble_circ_benchmark(void){
+	char msg[BLE_BENCH_MSG_LEN + 1];
+	char result[BLE_CIRC_SIZE];
+	uint32_t start;
+	uint32_t push_cycles = 0;
+	uint32_t pop_cycles = 0;
+	uint32_t bytes = 0;
+	uint32_t len;
+
+	while(ble_tx_busy());
+	memset(msg, 'b', BLE_BENCH_MSG_LEN);
+	msg[BLE_BENCH_MSG_LEN] = 0;
+	bench_open();
+	for(int i = 0; i < BLE_BENCH_ROUNDS; i++){
+		start = bench_cycles();
+		ble_circ_push(msg);
+		push_cycles += bench_cycles() - start;
+		start = bench_cycles();
+		ble_circ_pop(CIRC_TEST);
+		pop_cycles += bench_cycles() - start;
+		bytes += BLE_BENCH_MSG_LEN;
+	}
+	len = format_str(result, "push ");
+	len += format_uint(result + len, bytes * 1000 / push_cycles);
+	len += format_str(result + len, " B/kcyc pop ");
+	len += format_uint(result + len, bytes * 1000 / pop_cycles);
+	format_str(result + len, " B/kcyc\n");
+	ble_write(result);
+}
+#endif
@@ -0,0 +1,187 @@
+/**
+ * @file change.c
+ * @author Justin Thwaites
+ * @date 5/23/2020
+ * @brief Decides which temperature readings are worth reporting
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include "change.h"
+#include "ble.h"
+#include "format.h"
+
+//***********************************************************************************
+// private variables
+//***********************************************************************************
+static int32_t last_reported;
+static bool have_reported;
+static uint32_t periods;
+static int32_t delta;
+static uint32_t heartbeat;
+static CHANGE_STATS stats;
+
+/***************************************************************************//**
+ * @brief Change module
+ * @details
+ *  A reading is reported when it has moved more than the delta from the last
+ *  reported reading, or when the heartbeat number of periods has passed since
+ *  the last report, so a flat temperature is still seen to be alive.  The rest
+ *  are suppressed and counted.  The delta is also the hysteresis band the
+ *  application uses for the over temperature LED.
+ *
+ ******************************************************************************/
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ * Command handlers for the delta, the heartbeat and the counters.
+ *
+ * @note
+ *	These functions are private and are called through the command table.
+ ******************************************************************************/
+static CMD_STATUS change_cmd_delta(CMD_ARG *arg){
+	return change_set_delta(arg->value) ? CMD_OK : CMD_BAD_ARG;
+}
+
+static CMD_STATUS change_cmd_heartbeat(CMD_ARG *arg){
+	return change_set_heartbeat(arg->value) ? CMD_OK : CMD_BAD_ARG;
+}
+
+static CMD_STATUS change_cmd_stats(CMD_ARG *arg){
+	char reply[CHANGE_STATS_SIZE];
+	uint32_t len;
+
+	len = format_str(reply, "sent ");
+	len += format_uint(reply + len, stats.sent);
+	len += format_str(reply + len, " suppressed ");
+	len += format_uint(reply + len, stats.suppressed);
+	format_str(reply + len, "\n");
+	ble_reply(reply);
+	return CMD_OK;
+}
+
+static const CMD_ENTRY change_commands[] = {
+	{ CHANGE_DELTA_MESSAGE,		CMD_ARG_INT,  0, CHANGE_MAX_DELTA,     change_cmd_delta },
+	{ CHANGE_HEARTBEAT_MESSAGE,	CMD_ARG_INT,  1, CHANGE_MAX_HEARTBEAT, change_cmd_heartbeat },
+	{ CHANGE_STATS_MESSAGE,		CMD_ARG_NONE, 0, 0,                    change_cmd_stats },
+};
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *	Resets the change detection and registers its commands.
+ *
+ * @note
+ *	This function should only be called once in setup of the device, after command_open().
+ ******************************************************************************/
+void change_open(void){
+	have_reported = false;
+	periods = 0;
+	delta = CHANGE_DEFAULT_DELTA;
+	heartbeat = CHANGE_DEFAULT_HEARTBEAT;
+	stats.sent = 0;
+	stats.heartbeats = 0;
+	stats.suppressed = 0;
+	for(int i = 0; i < sizeof(change_commands) / sizeof(change_commands[0]); i++){
+		command_register(&change_commands[i]);
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Decides if a reading is reported.
+ *
+ * @details
+ *	The first reading is always reported.  After that a reading is reported when it differs
+ *	from the last reported reading by more than the delta, when the heartbeat is due, or when
+ *	forced.
+ *
+ * @note
+ *	Called once per sensor period, the heartbeat counts these calls.
+ *
+ * @param[in] value
+ *	The reading, in the same units as the delta.
+ *
+ * @param[in] force
+ *	Reports the reading regardless, for example when it raises an alert.
+ *
+ * @return
+ *	true if the reading should be sent.
+ ******************************************************************************/
+bool change_report(int32_t value, bool force){
+	int32_t moved = value - last_reported;
+
+	periods++;
+	if(have_reported && !force && moved <= delta && moved >= -delta){
+		if(periods < heartbeat){
+			stats.suppressed++;
+			return false;
+		}
+		stats.heartbeats++;
+	}
+	stats.sent++;
+	last_reported = value;
+	have_reported = true;
+	periods = 0;
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Sets how far a reading must move from the last report to be reported.
+ *
+ * @param[in] new_delta
+ *	0 to CHANGE_MAX_DELTA, 0 reports any change.
+ *
+ * @return
+ *	false if the delta is out of range.
+ ******************************************************************************/
+bool change_set_delta(uint32_t new_delta){
+	if(new_delta > CHANGE_MAX_DELTA) return false;
+	delta = new_delta;
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Sets the most periods between two reports.
+ *
+ * @param[in] new_periods
+ *	1 to CHANGE_MAX_HEARTBEAT, 1 reports every reading.
+ *
+ * @return
+ *	false if the number of periods is out of range.
+ ******************************************************************************/
+bool change_set_heartbeat(uint32_t new_periods){
+	if(new_periods < 1 || new_periods > CHANGE_MAX_HEARTBEAT) return false;
+	heartbeat = new_periods;
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Returns the delta, which is also the width of the LED1 hysteresis band.
+ ******************************************************************************/
+int32_t change_delta(void){
+	return delta;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Copies the report counters.
+ *
+ * @param[out] *stats_out
+ *	Receives the counters.
+ ******************************************************************************/
+void change_stats(CHANGE_STATS *stats_out){
+	*stats_out = stats;
+}
@@ -0,0 +1,115 @@
+/**
+ * @file cobs.c
+ * @author Justin Thwaites
+ * @date 5/6/2020
+ * @brief Consistent Overhead Byte Stuffing used to frame binary BLE messages
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include "cobs.h"
+
+/***************************************************************************//**
+ * @brief COBS module
+ * @details
+ *  COBS removes every 0x00 byte from a block of data at the cost of at most one
+ *  byte per 254 bytes, so 0x00 can be used as an unambiguous frame delimiter on
+ *  the UART.  An encoded frame is also a valid C string, which lets binary frames
+ *  travel through the same string based drivers as the text messages.
+ *
+ ******************************************************************************/
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *	Encodes a block of data so that it contains no 0x00 bytes.
+ *
+ * @details
+ *	Each run of up to 254 non zero bytes is preceded by a code byte that holds the
+ *	distance to the next 0x00 in the original data.  The trailing delimiter is not
+ *	written.
+ *
+ * @param[in] *src
+ *	The data to encode.
+ *
+ * @param[in] len
+ *	The number of bytes in src.
+ *
+ * @param[out] *dst
+ *	The buffer for the encoded data, must hold COBS_MAX_ENCODED(len) bytes.
+ *
+ * @return
+ *	The number of encoded bytes written to dst.
+ ******************************************************************************/
+uint32_t cobs_encode(const uint8_t *src, uint32_t len, uint8_t *dst){
+	uint32_t code_index = 0;
+	uint32_t write_index = 1;
+	uint8_t code = 1;
+
+	for(uint32_t i = 0; i < len; i++){
+		if(src[i] == 0){
+			dst[code_index] = code;
+			code_index = write_index++;
+			code = 1;
+		}
+		else{
+			dst[write_index++] = src[i];
+			code++;
+			if(code == 0xFF){
+				dst[code_index] = code;
+				code_index = write_index++;
+				code = 1;
+			}
+		}
+	}
+	dst[code_index] = code;
+	return write_index;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Decodes a COBS block back into the original data.
+ *
+ * @details
+ *	The delimiter must already be removed.  A block that contains a 0x00 byte or a
+ *	code byte that points past the end of the block is rejected.
+ *
+ * @param[in] *src
+ *	The encoded data.
+ *
+ * @param[in] len
+ *	The number of encoded bytes in src.
+ *
+ * @param[out] *dst
+ *	The buffer for the decoded data, must hold len bytes.
+ *
+ * @param[out] *dst_len
+ *	The number of decoded bytes.
+ *
+ * @return
+ *	true if the block was a valid COBS encoding.
+ ******************************************************************************/
+bool cobs_decode(const uint8_t *src, uint32_t len, uint8_t *dst, uint32_t *dst_len){
+	uint32_t read_index = 0;
+	uint32_t write_index = 0;
+	uint8_t code;
+
+	while(read_index < len){
+		code = src[read_index++];
+		if(code == 0 || read_index + code - 1 > len) return false;
+		for(uint8_t i = 1; i < code; i++){
+			if(src[read_index] == 0) return false;
+			dst[write_index++] = src[read_index++];
+		}
+		if(code != 0xFF && read_index < len){
+			dst[write_index++] = 0;
+		}
+	}
+	*dst_len = write_index;
+	return true;
+}
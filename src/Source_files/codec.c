@@ -0,0 +1,313 @@
+/**
+ * @file codec.c
+ * @author Justin Thwaites
+ * @date 5/26/2020
+ * @brief Packs timestamped sample sequences into delta and varint coded blocks
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include "codec.h"
+#include <string.h>
+#ifdef CODEC_BENCH_ENABLED
+#include "bench.h"
+#endif
+
+//***********************************************************************************
+// private variables
+//***********************************************************************************
+#ifdef CODEC_BENCH_ENABLED
+// centi-C, a slow indoor drift with sensor noise and a door opened at sample 20
+static const int32_t codec_trace[CODEC_BENCH_SAMPLES] = {
+	2231, 2232, 2231, 2233, 2234, 2233, 2235, 2236, 2235, 2237, 2238, 2238, 2239, 2241, 2240, 2242,
+	2243, 2242, 2244, 2245, 2198, 2151, 2117, 2094, 2081, 2076, 2079, 2088, 2101, 2117, 2134, 2150
+};
+#endif
+
+/***************************************************************************//**
+ * @brief Codec module
+ * @details
+ *  A block is the time of the first sample and the nominal interval between
+ *  samples, then the value of the first sample, then for every later sample
+ *  the change in value and the difference between its time step and the
+ *  interval.  Every field is a varint, 7 bits per byte with the top bit set
+ *  on all but the last byte, and the signed fields are zig-zag coded first so
+ *  small negative numbers stay short.  A temperature that drifts slowly and is
+ *  sampled on time packs into 2 bytes per sample.  The block has no sample
+ *  count, the decoder reads samples until the end of the block, so the frame
+ *  around it must carry its length.  The module only uses integer math and
+ *  no hardware, so codec_decode() also builds for the phone or host side.
+ *
+ ******************************************************************************/
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *	Zig-zag codes a signed value, 0, -1, 1, -2 ... become 0, 1, 2, 3 ...
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ ******************************************************************************/
+static uint32_t codec_zigzag(int32_t value){
+	return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Reverses codec_zigzag().
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ ******************************************************************************/
+static int32_t codec_unzigzag(uint32_t value){
+	return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Writes a varint and returns the number of bytes written, at most CODEC_VARINT_MAX.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ ******************************************************************************/
+static uint32_t codec_put_varint(uint8_t *dst, uint32_t value){
+	uint32_t len = 0;
+
+	while(value >= CODEC_VARINT_MORE){
+		dst[len++] = (value & (CODEC_VARINT_MORE - 1)) | CODEC_VARINT_MORE;
+		value >>= CODEC_VARINT_BITS;
+	}
+	dst[len++] = value;
+	return len;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Reads a varint at *pos and moves *pos past it.
+ *
+ * @return
+ *	false if the varint runs past the end of the block or is longer than CODEC_VARINT_MAX bytes.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ ******************************************************************************/
+static bool codec_get_varint(const uint8_t *src, uint32_t len, uint32_t *pos, uint32_t *value){
+	uint32_t shift = 0;
+
+	*value = 0;
+	for(uint32_t i = 0; i < CODEC_VARINT_MAX; i++){
+		if(*pos >= len) return false;
+		*value |= (uint32_t)(src[*pos] & (CODEC_VARINT_MORE - 1)) << shift;
+		if((src[(*pos)++] & CODEC_VARINT_MORE) == 0) return true;
+		shift += CODEC_VARINT_BITS;
+	}
+	return false;
+}
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *	Packs as many samples as fit into a block.
+ *
+ * @details
+ *	Samples are added in order until the next one would not fit, so a sequence longer
+ *	than one block is sent by calling again with the samples that were left.
+ *
+ * @param[in] *samples
+ *	The samples, oldest first.
+ *
+ * @param[in] count
+ *	The number of samples, at least 1.
+ *
+ * @param[in] interval
+ *	The nominal time between samples, a sample taken on time costs one byte for its time.
+ *
+ * @param[out] *dst
+ *	The buffer for the block.
+ *
+ * @param[in] size
+ *	The size of dst, at least CODEC_HEADER_MAX + CODEC_VARINT_MAX so the first sample fits.
+ *
+ * @param[out] *encoded
+ *	The number of samples packed.
+ *
+ * @return
+ *	The number of bytes written to dst.
+ ******************************************************************************/
+uint32_t codec_encode(const BATCH_SAMPLE *samples, uint32_t count, uint32_t interval,
+		uint8_t *dst, uint32_t size, uint32_t *encoded){
+	uint8_t next[CODEC_SAMPLE_MAX];
+	uint32_t next_len;
+	uint32_t len;
+	uint32_t i;
+
+	EFM_ASSERT(count > 0 && size >= CODEC_HEADER_MAX + CODEC_VARINT_MAX);
+	len = codec_put_varint(dst, samples[0].time);
+	len += codec_put_varint(dst + len, interval);
+	len += codec_put_varint(dst + len, codec_zigzag(samples[0].value));
+	for(i = 1; i < count; i++){
+		// the changes wrap modulo 2^32, so any two values have a change the decoder undoes
+		next_len = codec_put_varint(next, codec_zigzag((uint32_t)samples[i].value - (uint32_t)samples[i - 1].value));
+		next_len += codec_put_varint(next + next_len,
+				codec_zigzag(samples[i].time - samples[i - 1].time - interval));
+		if(len + next_len > size) break;
+		memcpy(dst + len, next, next_len);
+		len += next_len;
+	}
+	*encoded = i;
+	return len;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Unpacks a block written by codec_encode().
+ *
+ * @param[in] *src
+ *	The block.
+ *
+ * @param[in] len
+ *	The number of bytes in the block.
+ *
+ * @param[out] *samples
+ *	Receives the samples, oldest first.
+ *
+ * @param[in] max
+ *	The number of samples that fit in samples.
+ *
+ * @param[out] *count
+ *	The number of samples unpacked.
+ *
+ * @param[out] *interval
+ *	The nominal interval of the block.
+ *
+ * @return
+ *	false if the block is cut short, has a bad varint or holds more than max samples.
+ ******************************************************************************/
+bool codec_decode(const uint8_t *src, uint32_t len, BATCH_SAMPLE *samples, uint32_t max,
+		uint32_t *count, uint32_t *interval){
+	uint32_t pos = 0;
+	uint32_t time;
+	uint32_t value;
+	uint32_t step;
+
+	*count = 0;
+	if(max == 0 || !codec_get_varint(src, len, &pos, &time) || !codec_get_varint(src, len, &pos, interval)
+			|| !codec_get_varint(src, len, &pos, &value)){
+		return false;
+	}
+	samples[0].time = time;
+	samples[0].value = codec_unzigzag(value);
+	*count = 1;
+	while(pos < len){
+		if(*count >= max || !codec_get_varint(src, len, &pos, &value)
+				|| !codec_get_varint(src, len, &pos, &step)){
+			return false;
+		}
+		samples[*count].value = (uint32_t)samples[*count - 1].value + (uint32_t)codec_unzigzag(value);
+		samples[*count].time = samples[*count - 1].time + *interval + codec_unzigzag(step);
+		(*count)++;
+	}
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	This function tests the codec against a hand packed block and with round trips.
+ *
+ * @details
+ *	Covers a sample on time, early and late samples, a negative value and the largest
+ *	changes in value, a block split because it is too small, and blocks the decoder
+ *	must reject.
+ *
+ * @note
+ *	This function is a test and should only be called once.
+ ******************************************************************************/
+void codec_test(void){
+	static const BATCH_SAMPLE trace[CODEC_TEST_SAMPLES] = {
+		{ 1000, 2250 }, { 4100, 2251 }, { 7199, 2249 }, { 10301, -100 },
+		{ 13401, 2147483647 }, { 16501, -2147483647 - 1 }
+	};
+	// 1000, 3100, 2250, then +1 on time, -2 1 ms early
+	static const uint8_t packed[] = { 0xE8, 0x07, 0x9C, 0x18, 0x94, 0x23, 0x02, 0x00, 0x03, 0x01 };
+	uint8_t block[CODEC_TEST_SIZE];
+	BATCH_SAMPLE decoded[CODEC_TEST_SAMPLES];
+	uint32_t len;
+	uint32_t encoded;
+	uint32_t count;
+	uint32_t interval;
+
+	len = codec_encode(trace, 3, 3100, block, sizeof(block), &encoded);
+	EFM_ASSERT(encoded == 3 && len == sizeof(packed) && memcmp(block, packed, len) == 0);
+
+	len = codec_encode(trace, CODEC_TEST_SAMPLES, 3100, block, sizeof(block), &encoded);
+	EFM_ASSERT(encoded == CODEC_TEST_SAMPLES);
+	EFM_ASSERT(codec_decode(block, len, decoded, CODEC_TEST_SAMPLES, &count, &interval));
+	EFM_ASSERT(count == CODEC_TEST_SAMPLES && interval == 3100);
+	for(uint32_t i = 0; i < count; i++){
+		EFM_ASSERT(decoded[i].time == trace[i].time && decoded[i].value == trace[i].value);
+	}
+	EFM_ASSERT(!codec_decode(block, len, decoded, CODEC_TEST_SAMPLES - 1, &count, &interval));
+	EFM_ASSERT(!codec_decode(block, len - 1, decoded, CODEC_TEST_SAMPLES, &count, &interval));
+
+	len = codec_encode(trace, CODEC_TEST_SAMPLES, 3100, block, CODEC_HEADER_MAX + CODEC_VARINT_MAX, &encoded);
+	EFM_ASSERT(encoded == 4 && len == 13);
+	EFM_ASSERT(codec_decode(block, len, decoded, CODEC_TEST_SAMPLES, &count, &interval));
+	EFM_ASSERT(count == 4 && decoded[3].time == trace[3].time && decoded[3].value == trace[3].value);
+
+	memset(block, CODEC_VARINT_MORE, CODEC_VARINT_MAX + 1);
+	EFM_ASSERT(!codec_decode(block, CODEC_VARINT_MAX + 1, decoded, CODEC_TEST_SAMPLES, &count, &interval));
+	EFM_ASSERT(!codec_decode(packed, 2, decoded, CODEC_TEST_SAMPLES, &count, &interval));
+}
+
+#ifdef CODEC_BENCH_ENABLED
+/***************************************************************************//**
+ * @brief
+ *	Measures the bytes and cycles to send a temperature trace as text and as a packed block.
+ *
+ * @details
+ *	The text format is timed with the callback, which writes one sample the way the
+ *	application sends it.  The packed block is the whole trace in one codec_encode() call.
+ *
+ * @note
+ *	Uses the DWT cycle counter through bench_open().
+ *
+ * @param[in] text
+ *	Writes one sample in hundredths of a degree Celsius as text and returns its length.
+ *
+ * @param[out] *result
+ *	Receives the totals for the whole trace.
+ ******************************************************************************/
+void codec_benchmark(CODEC_TEXT_CB text, CODEC_BENCH_RESULT *result){
+	BATCH_SAMPLE samples[CODEC_BENCH_SAMPLES];
+	uint8_t block[CODEC_HEADER_MAX + CODEC_BENCH_SAMPLES * CODEC_SAMPLE_MAX];
+	char line[CODEC_BENCH_TEXT_SIZE];
+	uint32_t encoded;
+	uint32_t start;
+
+	for(uint32_t i = 0; i < CODEC_BENCH_SAMPLES; i++){
+		samples[i].time = i * CODEC_BENCH_INTERVAL;
+		samples[i].value = codec_trace[i];
+	}
+	bench_open();
+	result->samples = CODEC_BENCH_SAMPLES;
+	result->text_bytes = 0;
+	start = bench_cycles();
+	for(uint32_t i = 0; i < CODEC_BENCH_SAMPLES; i++){
+		result->text_bytes += text(line, codec_trace[i]);
+	}
+	result->text_cycles = bench_cycles() - start;
+	start = bench_cycles();
+	result->packed_bytes = codec_encode(samples, CODEC_BENCH_SAMPLES, CODEC_BENCH_INTERVAL,
+			block, sizeof(block), &encoded);
+	result->packed_cycles = bench_cycles() - start;
+	EFM_ASSERT(encoded == CODEC_BENCH_SAMPLES);
+}
+#endif
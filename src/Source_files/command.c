@@ -0,0 +1,181 @@
+/**
+ * @file command.c
+ * @author Justin Thwaites
+ * @date 5/8/2020
+ * @brief Table driven dispatcher for the commands received from the phone
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include <string.h>
+#include <stdlib.h>
+#include "em_assert.h"
+#include "command.h"
+
+//***********************************************************************************
+// private variables
+//***********************************************************************************
+typedef struct {
+	const CMD_ENTRY	*entry;
+	uint32_t		hash;
+} CMD_SLOT;
+
+static CMD_SLOT cmd_table[CMD_TABLE_SIZE];
+
+/***************************************************************************//**
+ * @brief Command module
+ * @details
+ *  Commands have the form "name" or "name=argument".  Each command is registered
+ *  once with its handler and argument type.  The name is hashed at registration and
+ *  the table is an open addressed hash table, so a received command costs one hash
+ *  of the name and normally a single string compare.
+ *
+ ******************************************************************************/
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *	32 bit FNV-1a hash of a command name.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ ******************************************************************************/
+static uint32_t command_hash(const char *name){
+	uint32_t hash = 2166136261u;
+	while(*name){
+		hash ^= (uint8_t)*name++;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Parses the argument of a command according to the argument type of its entry.
+ *
+ * @param[in] *entry
+ *	The table entry of the command.
+ *
+ * @param[in] *string
+ *	The text after the separator, or NULL if the command had no argument.
+ *
+ * @param[out] *arg
+ *	The parsed argument.
+ *
+ * @return
+ *	true if the argument matched the type and range of the entry.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ ******************************************************************************/
+static bool command_parse_arg(const CMD_ENTRY *entry, char *string, CMD_ARG *arg){
+	char *end;
+	long value;
+
+	arg->string = string;
+	arg->value = 0;
+	switch(entry->arg_type){
+		case CMD_ARG_NONE:
+			return string == NULL;
+
+		case CMD_ARG_INT:
+			if(string == NULL || *string == 0) return false;
+			value = strtol(string, &end, 10);
+			if(*end != 0 || value < entry->min || value > entry->max) return false;
+			arg->value = value;
+			return true;
+
+		case CMD_ARG_STRING:
+			return string != NULL;
+
+		default:
+			return false;
+	}
+}
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *	Empties the command table.
+ *
+ * @note
+ *	This function must be called once before any command is registered.
+ ******************************************************************************/
+void command_open(void){
+	memset(cmd_table, 0, sizeof(cmd_table));
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Adds a command to the table.
+ *
+ * @details
+ *	The entry is placed in the slot picked by its hash, or the next free slot after it.
+ *
+ * @param[in] *entry
+ *	The command entry.  The entry is not copied and must stay valid.
+ *
+ * @note
+ *	Registering the same name twice or more than CMD_TABLE_SIZE commands is an error.
+ ******************************************************************************/
+void command_register(const CMD_ENTRY *entry){
+	uint32_t hash = command_hash(entry->name);
+	uint32_t index = hash & CMD_TABLE_MASK;
+
+	for(uint32_t i = 0; i < CMD_TABLE_SIZE; i++){
+		CMD_SLOT *slot = &cmd_table[(index + i) & CMD_TABLE_MASK];
+		if(slot->entry == NULL){
+			slot->entry = entry;
+			slot->hash = hash;
+			return;
+		}
+		EFM_ASSERT(slot->hash != hash || strcmp(slot->entry->name, entry->name) != 0);
+	}
+	EFM_ASSERT(false);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Looks a received command up in the table, parses its argument and calls its handler.
+ *
+ * @details
+ *	The message is split at the first CMD_ARG_SEPARATOR.  Slots are probed from the hash
+ *	position until the name is found or an empty slot ends the search.
+ *
+ * @param[in] *message
+ *	The NUL terminated command, it is modified in place.
+ *
+ * @return
+ *	CMD_UNKNOWN or CMD_BAD_ARG if the command could not be run, otherwise the status
+ *	returned by the handler.
+ ******************************************************************************/
+CMD_STATUS command_dispatch(char *message){
+	CMD_ARG arg;
+	char *arg_string = strchr(message, CMD_ARG_SEPARATOR);
+	uint32_t hash;
+	uint32_t index;
+
+	if(arg_string != NULL){
+		*arg_string++ = 0;
+	}
+	hash = command_hash(message);
+	index = hash & CMD_TABLE_MASK;
+
+	for(uint32_t i = 0; i < CMD_TABLE_SIZE; i++){
+		CMD_SLOT *slot = &cmd_table[(index + i) & CMD_TABLE_MASK];
+		if(slot->entry == NULL) break;
+		if(slot->hash == hash && strcmp(slot->entry->name, message) == 0){
+			if(!command_parse_arg(slot->entry, arg_string, &arg)) return CMD_BAD_ARG;
+			return slot->entry->handler(&arg);
+		}
+	}
+	return CMD_UNKNOWN;
+}
@@ -0,0 +1,293 @@
+/**
+ * @file config.c
+ * @author Justin Thwaites
+ * @date 5/29/2020
+ * @brief Runtime configuration kept in the flash user data page
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include "config.h"
+
+//***********************************************************************************
+// linker symbols
+//***********************************************************************************
+extern char __etext;				// end of the code, the .data image follows it
+extern char __data_start__;
+extern char __data_end__;
+
+//***********************************************************************************
+// private variables
+//***********************************************************************************
+static const CONFIG_LIMIT limits[CONFIG_KEYS] = {
+	[CONFIG_PERIOD]		= { CONFIG_PERIOD_MIN,		CONFIG_PERIOD_MAX,		CONFIG_PERIOD_DEFAULT },
+	[CONFIG_ACTIVE]		= { CONFIG_ACTIVE_MIN,		CONFIG_PERIOD_MAX,		CONFIG_ACTIVE_DEFAULT },
+	[CONFIG_BAUD]		= { CONFIG_BAUD_MIN,		CONFIG_BAUD_MAX,		CONFIG_BAUD_DEFAULT },
+	[CONFIG_CELSIUS]	= { false,					true,					false },
+	[CONFIG_I2C_FREQ]	= { CONFIG_I2C_FREQ_MIN,	I2C_FREQ_FAST_MAX,		CONFIG_I2C_FREQ_DEFAULT },
+	[CONFIG_HM10_FAST]	= { false,					true,					false },
+};
+static uint32_t cache[CONFIG_KEYS];
+static uint32_t next_slot;			// first free record, CONFIG_RECORDS if the page must be rewritten
+static CONFIG_CHANGE_CB change_cb;
+
+/***************************************************************************//**
+ * @brief Config module
+ * @details
+ *  Settings that used to be fixed at compile time are kept in the user data
+ *  page, so a deployed unit can be tuned over BLE without a reflash.  The page
+ *  starts with a header holding the layout version, followed by records of a
+ *  key and a value.  Changing a setting appends a record, programming its value
+ *  before its key, so the record is either complete or ignored after a power
+ *  failure, and the last complete record of a key wins.  When the page is full
+ *  it is compacted to the current settings, first into a spare main flash page
+ *  just below the flash log, then into the user data page, and the spare page
+ *  is erased again.  Each copy is written with its magic word last, so after a
+ *  power failure a complete spare page is the newest set and config_open()
+ *  finishes the rewrite from it, and otherwise the user data page still holds
+ *  the last good set.
+ *
+ *  The page is read once in config_open() into a RAM cache, and config_get()
+ *  only reads the cache, so no caller waits on the flash.  A header with a
+ *  different version is treated as an empty page.
+ *
+ ******************************************************************************/
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *	Returns the header and a record slot of the user data page.
+ *
+ * @note
+ *	These functions are private helper functions that only have local scope.
+ ******************************************************************************/
+static CONFIG_HEADER *config_header(uint32_t base){
+	return (CONFIG_HEADER *)base;
+}
+
+static CONFIG_RECORD *config_record(uint32_t base, uint32_t slot){
+	return (CONFIG_RECORD *)(config_header(base) + 1) + slot;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Returns if a page holds a complete set of records of this layout.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ ******************************************************************************/
+static bool config_page_valid(uint32_t base){
+	return config_header(base)->magic == CONFIG_MAGIC && config_header(base)->version == CONFIG_VERSION;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Reads the complete records of a page into the cache and returns the slot after the last one programmed.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ ******************************************************************************/
+static uint32_t config_load(uint32_t base){
+	CONFIG_RECORD *record;
+	uint32_t next = 0;
+
+	for(uint32_t slot = 0; slot < CONFIG_RECORDS; slot++){
+		record = config_record(base, slot);
+		if(record->value == CONFIG_ERASED && record->key == CONFIG_ERASED) continue;
+		next = slot + 1;
+		if(record->key < CONFIG_KEYS && record->value >= limits[record->key].min
+				&& record->value <= limits[record->key].max){
+			cache[record->key] = record->value;
+		}
+	}
+	return next;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Returns if a value is allowed for a key.
+ *
+ * @details
+ *	Besides the range of the key, the PWM active time must stay shorter than the period and the
+ *	baud rate must be one the HM10 supports, CONFIG_BAUD_MIN doubled zero or more times.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ ******************************************************************************/
+static bool config_valid(CONFIG_KEY key, uint32_t value){
+	if(value < limits[key].min || value > limits[key].max) return false;
+	if(key == CONFIG_PERIOD) return value > cache[CONFIG_ACTIVE];
+	if(key == CONFIG_ACTIVE) return value < cache[CONFIG_PERIOD];
+	if(key == CONFIG_BAUD) return value % CONFIG_BAUD_MIN == 0 && ((value / CONFIG_BAUD_MIN) & (value / CONFIG_BAUD_MIN - 1)) == 0;
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Erases a page and writes the cache to it as the first records, the magic word last.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope, called between
+ *	MSC_Init() and MSC_Deinit().
+ ******************************************************************************/
+static void config_write_page(uint32_t base){
+	CONFIG_RECORD record;
+	uint32_t version = CONFIG_VERSION;
+	uint32_t magic = CONFIG_MAGIC;
+
+	EFM_ASSERT(MSC_ErasePage((uint32_t *)base) == mscReturnOk);
+	for(uint32_t key = 0; key < CONFIG_KEYS; key++){
+		record.value = cache[key];
+		record.key = key;
+		EFM_ASSERT(MSC_WriteWord((uint32_t *)config_record(base, key), &record, sizeof(record)) == mscReturnOk);
+	}
+	EFM_ASSERT(MSC_WriteWord(&config_header(base)->version, &version, sizeof(version)) == mscReturnOk);
+	EFM_ASSERT(MSC_WriteWord(&config_header(base)->magic, &magic, sizeof(magic)) == mscReturnOk);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Rewrites the user data page with the cache.
+ *
+ * @details
+ *	The cache is staged in the spare page first, so that one of the two pages holds a
+ *	complete set at every point of the rewrite.  With stage false the spare page already
+ *	holds the cache, as when config_open() finishes an interrupted rewrite.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ ******************************************************************************/
+static void config_rewrite(bool stage){
+	MSC_Init();
+	if(stage) config_write_page(CONFIG_SPARE_BASE);
+	config_write_page(CONFIG_BASE);
+	EFM_ASSERT(MSC_ErasePage((uint32_t *)CONFIG_SPARE_BASE) == mscReturnOk);
+	MSC_Deinit();
+	next_slot = CONFIG_KEYS;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Command handlers for the settings.
+ *
+ * @note
+ *	These functions are private and are called through the command table.
+ ******************************************************************************/
+static CMD_STATUS config_cmd_period(CMD_ARG *arg){
+	return config_set(CONFIG_PERIOD, arg->value) ? CMD_OK : CMD_BAD_ARG;
+}
+
+static CMD_STATUS config_cmd_active(CMD_ARG *arg){
+	return config_set(CONFIG_ACTIVE, arg->value) ? CMD_OK : CMD_BAD_ARG;
+}
+
+static CMD_STATUS config_cmd_i2c_freq(CMD_ARG *arg){
+	return config_set(CONFIG_I2C_FREQ, arg->value) ? CMD_OK : CMD_BAD_ARG;
+}
+
+static const CMD_ENTRY config_commands[] = {
+	{ CONFIG_PERIOD_MESSAGE,	CMD_ARG_INT, CONFIG_PERIOD_MIN,		CONFIG_PERIOD_MAX,	config_cmd_period },
+	{ CONFIG_ACTIVE_MESSAGE,	CMD_ARG_INT, CONFIG_ACTIVE_MIN,		CONFIG_PERIOD_MAX,	config_cmd_active },
+	{ CONFIG_I2C_FREQ_MESSAGE,	CMD_ARG_INT, CONFIG_I2C_FREQ_MIN,	I2C_FREQ_FAST_MAX,	config_cmd_i2c_freq },
+};
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *	Loads the settings from the user data page into the cache and registers the config commands.
+ *
+ * @details
+ *	Keys without a complete record keep their default.  Incomplete records are skipped, and
+ *	the next record is appended after the last one programmed.  A complete spare page left by
+ *	an interrupted rewrite is loaded instead, and the rewrite finished from it.
+ *
+ * @note
+ *	This function should only be called once in setup of the device, after command_open()
+ *	and before any module that reads its settings is opened.
+ *
+ * @param[in] change
+ *	Called with the key after a setting is changed, so the owner of a setting that can be
+ *	applied at run time applies it.
+ ******************************************************************************/
+void config_open(CONFIG_CHANGE_CB change){
+	EFM_ASSERT(change != NULL);
+	change_cb = change;
+	// the linker scripts stop FLASH below the spare page and the flash log, this catches a regenerated one that does not
+	EFM_ASSERT((uint32_t)&__etext + (uint32_t)(&__data_end__ - &__data_start__) <= CONFIG_SPARE_BASE);
+
+	for(uint32_t key = 0; key < CONFIG_KEYS; key++){
+		cache[key] = limits[key].initial;
+	}
+	next_slot = CONFIG_RECORDS;
+	if(config_page_valid(CONFIG_SPARE_BASE)){
+		config_load(CONFIG_SPARE_BASE);
+		config_rewrite(false);
+	}
+	else if(config_page_valid(CONFIG_BASE)){
+		next_slot = config_load(CONFIG_BASE);
+	}
+	for(int i = 0; i < sizeof(config_commands) / sizeof(config_commands[0]); i++){
+		command_register(&config_commands[i]);
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Returns a setting from the cache.
+ ******************************************************************************/
+uint32_t config_get(CONFIG_KEY key){
+	EFM_ASSERT(key < CONFIG_KEYS);
+	return cache[key];
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Changes a setting in the cache and in the user data page.
+ *
+ * @details
+ *	Setting a key to its current value does not write the flash.  The change callback is
+ *	called after the cache is updated.  The period and active time are applied at run time,
+ *	the other settings are read when their module is opened, at the next reset.
+ *
+ * @note
+ *	Programming the flash stalls the CPU, for a page erase about 20 ms and three of them when
+ *	the page is compacted, so this should be called from a command, not from a hot path.
+ *
+ * @param[in] key
+ *	The setting.
+ *
+ * @param[in] value
+ *	The new value.
+ *
+ * @return
+ *	false if the value is not allowed for the key.
+ ******************************************************************************/
+bool config_set(CONFIG_KEY key, uint32_t value){
+	CONFIG_RECORD record;
+
+	EFM_ASSERT(key < CONFIG_KEYS);
+	if(!config_valid(key, value)) return false;
+	if(cache[key] == value) return true;
+	cache[key] = value;
+	if(next_slot >= CONFIG_RECORDS){
+		config_rewrite(true);
+	}
+	else{
+		record.value = value;
+		record.key = key;
+		MSC_Init();
+		EFM_ASSERT(MSC_WriteWord((uint32_t *)config_record(CONFIG_BASE, next_slot), &record, sizeof(record)) == mscReturnOk);
+		MSC_Deinit();
+		next_slot++;
+	}
+	change_cb(key);
+	return true;
+}
@@ -0,0 +1,296 @@
+/**
+ * @file filter.c
+ * @author Justin Thwaites
+ * @date 5/24/2020
+ * @brief Fixed point filters run on each sensor sample before it is reported
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include "filter.h"
+#include "format.h"
+#include <string.h>
+
+//***********************************************************************************
+// private variables
+//***********************************************************************************
+static FILTER *command_filter;
+
+/***************************************************************************//**
+ * @brief Filter module
+ * @details
+ *  A filter is a chain of up to FILTER_MAX_STAGES stages, each fed the output of
+ *  the one before.  A stage is a moving average or a median over a window of
+ *  samples, or a single pole IIR y += a / 256 * (x - y) with an integer
+ *  coefficient a.  Only integer math is used and every stage rounds to nearest,
+ *  so a constant input comes out unchanged.  Until a window is full the stages
+ *  work on the samples held so far, and the IIR starts at the first sample, so
+ *  there is no ramp up from zero after a reset.
+ *
+ ******************************************************************************/
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *	Runs one stage of the filter on a sample.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ ******************************************************************************/
+static int32_t filter_stage_run(FILTER_STAGE *stage, int32_t sample){
+	int32_t sorted[FILTER_MAX_WINDOW];
+	int64_t step;
+
+	if(stage->type == FILTER_IIR){
+		if(stage->count == 0){
+			stage->state = sample * FILTER_IIR_ONE;
+			stage->count = 1;
+		}
+		else{
+			step = (int64_t)(sample * FILTER_IIR_ONE - stage->state) * stage->param;
+			step += step < 0 ? -FILTER_IIR_ONE / 2 : FILTER_IIR_ONE / 2;
+			stage->state += step / FILTER_IIR_ONE;
+		}
+		return format_round_div(stage->state, FILTER_IIR_ONE);
+	}
+
+	if(stage->count == stage->param){
+		stage->sum -= stage->history[stage->next];
+	}
+	else{
+		stage->count++;
+	}
+	stage->history[stage->next] = sample;
+	stage->sum += sample;
+	stage->next = (stage->next + 1) % stage->param;
+
+	if(stage->type == FILTER_AVERAGE){
+		return format_round_div(stage->sum, stage->count);
+	}
+
+	//insertion sort of the held samples, the window is at most FILTER_MAX_WINDOW
+	for(uint32_t i = 0; i < stage->count; i++){
+		uint32_t j = i;
+		while(j > 0 && sorted[j - 1] > stage->history[i]){
+			sorted[j] = sorted[j - 1];
+			j--;
+		}
+		sorted[j] = stage->history[i];
+	}
+	if(stage->count & 1){
+		return sorted[stage->count / 2];
+	}
+	return format_round_div(sorted[stage->count / 2 - 1] + sorted[stage->count / 2], 2);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Runs a test vector through a filter and checks every output against the reference.
+ *
+ * @note
+ *	This function is a private helper function of filter_test().
+ ******************************************************************************/
+static void filter_test_vector(const char *spec, const int32_t *input, const int32_t *expected){
+	FILTER filter;
+
+	EFM_ASSERT(filter_configure(&filter, spec));
+	for(uint32_t i = 0; i < FILTER_TEST_SAMPLES; i++){
+		EFM_ASSERT(filter_run(&filter, input[i]) == expected[i]);
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ * Command handler that sets the stages of the filter given to filter_open().
+ *
+ * @note
+ *	This function is private and is called through the command table.
+ ******************************************************************************/
+static CMD_STATUS filter_cmd_configure(CMD_ARG *arg){
+	return filter_configure(command_filter, arg->string) ? CMD_OK : CMD_BAD_ARG;
+}
+
+static const CMD_ENTRY filter_command = {
+	FILTER_MESSAGE, CMD_ARG_STRING, 0, 0, filter_cmd_configure
+};
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *	Registers the "Filter" command to configure a filter over BLE.
+ *
+ * @note
+ *	This function should only be called once in setup of the device, after command_open().
+ *
+ * @param[in] *filter
+ *	The filter the command configures, set up with filter_init() or filter_configure().
+ ******************************************************************************/
+void filter_open(FILTER *filter){
+	EFM_ASSERT(filter != NULL);
+	command_filter = filter;
+	command_register(&filter_command);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Sets up a filter with no stages, which passes samples through unchanged.
+ ******************************************************************************/
+void filter_init(FILTER *filter){
+	filter->stage_count = 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Adds a stage to the end of the filter.
+ *
+ * @param[in] type
+ *	The kind of stage.
+ *
+ * @param[in] param
+ *	The window, 1 to FILTER_MAX_WINDOW, of a FILTER_AVERAGE or FILTER_MEDIAN stage, or the
+ *	coefficient, 1 to FILTER_IIR_ONE, of a FILTER_IIR stage.
+ *
+ * @return
+ *	false if the filter already has FILTER_MAX_STAGES stages or the parameter is out of range.
+ ******************************************************************************/
+bool filter_add_stage(FILTER *filter, FILTER_TYPE type, uint32_t param){
+	FILTER_STAGE *stage;
+	uint32_t max = type == FILTER_IIR ? FILTER_IIR_ONE : FILTER_MAX_WINDOW;
+
+	if(filter->stage_count >= FILTER_MAX_STAGES || param < 1 || param > max) return false;
+	stage = &filter->stages[filter->stage_count++];
+	stage->type = type;
+	stage->param = param;
+	stage->count = 0;
+	stage->next = 0;
+	stage->sum = 0;
+	stage->state = 0;
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Replaces the stages of a filter with the ones listed in a string.
+ *
+ * @details
+ *	The list is stages separated by FILTER_SEPARATOR, each a letter and a number: "A4" is a
+ *	moving average of 4 samples, "M3" a median of 3 samples and "I64" an IIR with a coefficient
+ *	of 64 / 256.  "M3,I64" takes the median first.  An empty string removes every stage.
+ *
+ * @param[in] *spec
+ *	The NUL terminated list.
+ *
+ * @return
+ *	false, leaving the filter unchanged, if the list is not valid.
+ ******************************************************************************/
+bool filter_configure(FILTER *filter, const char *spec){
+	FILTER parsed;
+	FILTER_TYPE type;
+	uint32_t param;
+
+	filter_init(&parsed);
+	while(*spec){
+		if(*spec == FILTER_AVERAGE_CHAR) type = FILTER_AVERAGE;
+		else if(*spec == FILTER_MEDIAN_CHAR) type = FILTER_MEDIAN;
+		else if(*spec == FILTER_IIR_CHAR) type = FILTER_IIR;
+		else return false;
+		spec++;
+		if(*spec < '0' || *spec > '9') return false;
+		param = 0;
+		while(*spec >= '0' && *spec <= '9' && param <= FILTER_IIR_ONE){
+			param = param * 10 + (*spec++ - '0');
+		}
+		if(!filter_add_stage(&parsed, type, param)) return false;
+		if(*spec == FILTER_SEPARATOR){
+			spec++;
+			if(*spec == 0) return false;
+		}
+		else if(*spec != 0) return false;
+	}
+	*filter = parsed;
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Empties the history of every stage, so the next sample starts the filter again.
+ ******************************************************************************/
+void filter_reset(FILTER *filter){
+	for(uint32_t i = 0; i < filter->stage_count; i++){
+		filter->stages[i].count = 0;
+		filter->stages[i].next = 0;
+		filter->stages[i].sum = 0;
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Runs a sample through every stage of the filter.
+ *
+ * @param[in] sample
+ *	The sample, at most 2^22 in magnitude so the IIR state fits in 32 bits.
+ *
+ * @return
+ *	The filtered sample.
+ ******************************************************************************/
+int32_t filter_run(FILTER *filter, int32_t sample){
+	for(uint32_t i = 0; i < filter->stage_count; i++){
+		sample = filter_stage_run(&filter->stages[i], sample);
+	}
+	return sample;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	This function tests the filter stages against reference vectors.
+ *
+ * @details
+ *	The expected outputs were computed with exact fractions rounded half away from zero.
+ *	The vectors cover a spike removed by a median, the start up and a negative sample of a
+ *	moving average, an IIR step in both directions, a median then IIR chain, an even median
+ *	window, and lists filter_configure() must reject.
+ *
+ * @note
+ *	This function is a test and should only be called once.
+ ******************************************************************************/
+void filter_test(void){
+	static const int32_t spike[FILTER_TEST_SAMPLES] = { 100, 100, 900, 100, 100, 50, 50, -20 };
+	static const int32_t spike_m3[FILTER_TEST_SAMPLES] = { 100, 100, 100, 100, 100, 100, 50, 50 };
+	static const int32_t ramp[FILTER_TEST_SAMPLES] = { 0, 10, 20, 30, 40, 50, 60, -5 };
+	static const int32_t ramp_a4[FILTER_TEST_SAMPLES] = { 0, 5, 10, 15, 25, 35, 45, 36 };
+	static const int32_t step_up[FILTER_TEST_SAMPLES] = { 0, 1000, 1000, 1000, 1000, 1000, 1000, 1000 };
+	static const int32_t step_up_i64[FILTER_TEST_SAMPLES] = { 0, 250, 438, 578, 684, 763, 822, 867 };
+	static const int32_t step_down[FILTER_TEST_SAMPLES] = { 0, -1000, -1000, -1000, -1000, -1000, -1000, -1000 };
+	static const int32_t step_down_i64[FILTER_TEST_SAMPLES] = { 0, -250, -438, -578, -684, -763, -822, -867 };
+	static const int32_t chain[FILTER_TEST_SAMPLES] = { 100, 100, 900, 100, 100, 300, 300, 300 };
+	static const int32_t chain_m3_i128[FILTER_TEST_SAMPLES] = { 100, 100, 100, 100, 100, 100, 200, 250 };
+	static const int32_t even[FILTER_TEST_SAMPLES] = { 10, 30, 20, 40, 40, 40, 40, 40 };
+	static const int32_t even_m4[FILTER_TEST_SAMPLES] = { 10, 20, 20, 25, 35, 40, 40, 40 };
+	FILTER filter;
+
+	filter_test_vector("M3", spike, spike_m3);
+	filter_test_vector("A4", ramp, ramp_a4);
+	filter_test_vector("I64", step_up, step_up_i64);
+	filter_test_vector("I64", step_down, step_down_i64);
+	filter_test_vector("M3,I128", chain, chain_m3_i128);
+	filter_test_vector("M4", even, even_m4);
+	filter_test_vector("", ramp, ramp);
+
+	EFM_ASSERT(filter_configure(&filter, "A2"));
+	EFM_ASSERT(!filter_configure(&filter, "X3"));
+	EFM_ASSERT(!filter_configure(&filter, "A10"));
+	EFM_ASSERT(!filter_configure(&filter, "A0"));
+	EFM_ASSERT(!filter_configure(&filter, "I257"));
+	EFM_ASSERT(!filter_configure(&filter, "M3,"));
+	EFM_ASSERT(!filter_configure(&filter, "M3A4"));
+	EFM_ASSERT(!filter_configure(&filter, "M3,A2,I1,A2"));
+	EFM_ASSERT(filter.stage_count == 1 && filter.stages[0].type == FILTER_AVERAGE);	// unchanged by a bad list
+}
@@ -0,0 +1,358 @@
+/**
+ * @file flash_log.c
+ * @author Justin Thwaites
+ * @date 5/27/2020
+ * @brief Circular log of samples in the on-chip flash
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include "flash_log.h"
+
+//***********************************************************************************
+// private variables
+//***********************************************************************************
+static uint32_t head_page;			// page records are appended to
+static uint32_t head_slot;			// next free record of the head page
+static uint32_t head_sequence;
+static uint32_t read_page;			// position of the oldest unsent record
+static uint32_t read_slot;
+static FLASH_LOG_RECORD buffer[FLASH_LOG_BUFFER];
+static uint32_t buffered;
+static FLASH_LOG_STATS stats;
+
+/***************************************************************************//**
+ * @brief Flash log module
+ * @details
+ *  The log is FLASH_LOG_PAGES pages at the top of the main flash, used as a
+ *  ring.  Each page starts with a header holding a sequence number, and records
+ *  are only ever appended after it, so the pages are erased in turn and wear
+ *  evenly.  A page is started by erasing it and programming its sequence before
+ *  the magic word, and a record by programming its value before its time, so a
+ *  page or record cut short by a power failure is recognised and skipped when
+ *  the log is opened again.  Samples are held in RAM and programmed
+ *  FLASH_LOG_BUFFER at a time, one flash write and a page erase every
+ *  FLASH_LOG_RECORDS samples, so the flash is kept awake far less than the radio
+ *  would be to send each sample.  The cost is that the samples still in RAM are
+ *  lost if the power fails.
+ *
+ *  Reading does not remove records.  Once every record of a page has been read
+ *  and consumed, the sent word of its header is cleared, so after a reset the
+ *  log resumes with the first page not yet sent.  The records of that page that
+ *  were already sent before the reset are sent again.  The timestamps are the ms
+ *  since the boot that recorded them.
+ *
+ ******************************************************************************/
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *	Returns the header of a page of the log.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ ******************************************************************************/
+static FLASH_LOG_HEADER *flash_log_header(uint32_t page){
+	return (FLASH_LOG_HEADER *)(FLASH_LOG_BASE + page * FLASH_PAGE_SIZE);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Returns a record slot of a page of the log.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ ******************************************************************************/
+static FLASH_LOG_RECORD *flash_log_record(uint32_t page, uint32_t slot){
+	return (FLASH_LOG_RECORD *)(flash_log_header(page) + 1) + slot;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Returns if a page was started completely.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ ******************************************************************************/
+static bool flash_log_valid(uint32_t page){
+	return flash_log_header(page)->magic == FLASH_LOG_MAGIC;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Clears the sent word of a page whose records have all been consumed.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ ******************************************************************************/
+static void flash_log_mark_sent(uint32_t page){
+	uint32_t sent = FLASH_LOG_SENT;
+
+	if(!flash_log_valid(page) || flash_log_header(page)->sent != FLASH_LOG_ERASED) return;
+	MSC_Init();
+	EFM_ASSERT(MSC_WriteWord(&flash_log_header(page)->sent, &sent, sizeof(sent)) == mscReturnOk);
+	MSC_Deinit();
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Finds the next complete record from a position and moves the position past it.
+ *
+ * @details
+ *	Pages that were not started completely and records that were cut short are skipped.
+ *	When consuming, a page is marked as sent as the position leaves it.
+ *
+ * @return
+ *	false if there is no record between the position and the head.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ ******************************************************************************/
+static bool flash_log_next(uint32_t *page, uint32_t *slot, bool consume, FLASH_LOG_RECORD **record){
+	FLASH_LOG_RECORD *slot_record;
+
+	while(!(*page == head_page && *slot >= head_slot)){
+		if(*slot >= FLASH_LOG_RECORDS || !flash_log_valid(*page)){
+			if(consume) flash_log_mark_sent(*page);
+			*page = (*page + 1) % FLASH_LOG_PAGES;
+			*slot = 0;
+			continue;
+		}
+		slot_record = flash_log_record(*page, (*slot)++);
+		if(slot_record->time != FLASH_LOG_ERASED){
+			*record = slot_record;
+			return true;
+		}
+	}
+	return false;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Erases the page after the head and starts it as the new head.
+ *
+ * @details
+ *	If the oldest unsent records are on that page the log is full, and they are
+ *	counted as lost and the read position moves to the next oldest page.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.  MSC_Init() must
+ *	have been called.
+ ******************************************************************************/
+static void flash_log_start_page(void){
+	uint32_t next = (head_page + 1) % FLASH_LOG_PAGES;
+	uint32_t sequence = head_sequence + 1;
+	uint32_t magic = FLASH_LOG_MAGIC;
+	FLASH_LOG_HEADER *header = flash_log_header(next);
+
+	if(next == read_page){
+		stats.lost += read_slot < FLASH_LOG_RECORDS ? FLASH_LOG_RECORDS - read_slot : 0;
+		read_page = (next + 1) % FLASH_LOG_PAGES;
+		read_slot = 0;
+	}
+	EFM_ASSERT(MSC_ErasePage((uint32_t *)header) == mscReturnOk);
+	stats.erases++;
+	EFM_ASSERT(MSC_WriteWord(&header->sequence, &sequence, sizeof(sequence)) == mscReturnOk);
+	EFM_ASSERT(MSC_WriteWord(&header->magic, &magic, sizeof(magic)) == mscReturnOk);
+	head_page = next;
+	head_slot = 0;
+	head_sequence = sequence;
+}
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *	Finds the head and the oldest unsent record of the log left in flash.
+ *
+ * @details
+ *	The head is the complete page with the highest sequence, and its free slots are the
+ *	erased ones after the last programmed record.  The pages after the head are the oldest,
+ *	so the read position is the first complete page after the head that is not marked as
+ *	sent.  With no complete page the log is empty and the first sample starts page 0.
+ *
+ * @note
+ *	This function should only be called once in setup of the device.
+ ******************************************************************************/
+void flash_log_open(void){
+	bool found = false;
+	FLASH_LOG_RECORD *record;
+	uint32_t page;
+
+	buffered = 0;
+	for(page = 0; page < FLASH_LOG_PAGES; page++){
+		if(flash_log_valid(page) && (!found || flash_log_header(page)->sequence > head_sequence)){
+			head_page = page;
+			head_sequence = flash_log_header(page)->sequence;
+			found = true;
+		}
+	}
+	if(!found){
+		head_page = FLASH_LOG_PAGES - 1;
+		head_slot = FLASH_LOG_RECORDS;		// full, so the first write starts page 0
+		head_sequence = 0;
+		read_page = head_page;
+		read_slot = head_slot;
+		return;
+	}
+	head_slot = FLASH_LOG_RECORDS;
+	while(head_slot > 0){
+		record = flash_log_record(head_page, head_slot - 1);
+		if(record->value != FLASH_LOG_ERASED || record->time != FLASH_LOG_ERASED) break;
+		head_slot--;
+	}
+	read_page = head_page;
+	read_slot = head_slot;
+	for(uint32_t i = 1; i <= FLASH_LOG_PAGES; i++){
+		page = (head_page + i) % FLASH_LOG_PAGES;
+		if(flash_log_valid(page) && flash_log_header(page)->sent == FLASH_LOG_ERASED){
+			read_page = page;
+			read_slot = 0;
+			break;
+		}
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Adds a sample to the log.
+ *
+ * @details
+ *	The sample is held in RAM until FLASH_LOG_BUFFER samples are waiting, which are then
+ *	programmed together.
+ *
+ * @param[in] *sample
+ *	The sample.  A time of FLASH_LOG_ERASED cannot be stored and the sample is dropped.
+ ******************************************************************************/
+void flash_log_append(const BATCH_SAMPLE *sample){
+	if(sample->time == FLASH_LOG_ERASED) return;
+	buffer[buffered].value = sample->value;
+	buffer[buffered].time = sample->time;
+	buffered++;
+	stats.appended++;
+	if(buffered == FLASH_LOG_BUFFER){
+		flash_log_sync();
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Programs the samples held in RAM into the flash.
+ *
+ * @details
+ *	The samples are programmed with as few writes as the page boundaries allow, starting a
+ *	new page when the head is full.
+ ******************************************************************************/
+void flash_log_sync(void){
+	uint32_t done = 0;
+	uint32_t count;
+
+	if(buffered == 0) return;
+	MSC_Init();
+	while(done < buffered){
+		if(head_slot >= FLASH_LOG_RECORDS){
+			flash_log_start_page();
+		}
+		count = buffered - done;
+		if(count > FLASH_LOG_RECORDS - head_slot){
+			count = FLASH_LOG_RECORDS - head_slot;
+		}
+		EFM_ASSERT(MSC_WriteWord((uint32_t *)flash_log_record(head_page, head_slot), &buffer[done],
+				count * sizeof(FLASH_LOG_RECORD)) == mscReturnOk);
+		stats.programs++;
+		head_slot += count;
+		done += count;
+	}
+	MSC_Deinit();
+	buffered = 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Returns if the log holds samples that have not been consumed, in flash or in RAM.
+ ******************************************************************************/
+bool flash_log_pending(void){
+	uint32_t page = read_page;
+	uint32_t slot = read_slot;
+	FLASH_LOG_RECORD *record;
+
+	return buffered > 0 || flash_log_next(&page, &slot, false, &record);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Returns the number of samples waiting to be sent, in flash or in RAM.
+ *
+ * @details
+ *	Counted from the slots between the read position and the head without reading the
+ *	flash, so records cut short by a power failure are included and the count is an upper bound.
+ ******************************************************************************/
+uint32_t flash_log_backlog(void){
+	uint32_t pages = (head_page + FLASH_LOG_PAGES - read_page) % FLASH_LOG_PAGES;
+
+	return pages * FLASH_LOG_RECORDS + head_slot - read_slot + buffered;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Copies the oldest unsent samples from the flash, without removing them.
+ *
+ * @note
+ *	Samples still held in RAM are not read, call flash_log_sync() first.
+ *
+ * @param[out] *samples
+ *	Receives the samples, oldest first.
+ *
+ * @param[in] max
+ *	The number of samples that fit in samples.
+ *
+ * @return
+ *	The number of samples copied.
+ ******************************************************************************/
+uint32_t flash_log_read(BATCH_SAMPLE *samples, uint32_t max){
+	uint32_t page = read_page;
+	uint32_t slot = read_slot;
+	FLASH_LOG_RECORD *record;
+	uint32_t count = 0;
+
+	while(count < max && flash_log_next(&page, &slot, false, &record)){
+		samples[count].time = record->time;
+		samples[count].value = record->value;
+		count++;
+	}
+	return count;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Removes the oldest unsent samples once they have been sent.
+ *
+ * @param[in] count
+ *	The number of samples, at most the number returned by the last flash_log_read().
+ ******************************************************************************/
+void flash_log_consume(uint32_t count){
+	FLASH_LOG_RECORD *record;
+
+	while(count > 0 && flash_log_next(&read_page, &read_slot, true, &record)){
+		stats.sent++;
+		count--;
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Copies the log counters.
+ *
+ * @param[out] *stats_out
+ *	Receives the counters.
+ ******************************************************************************/
+void flash_log_stats(FLASH_LOG_STATS *stats_out){
+	*stats_out = stats;
+}
@@ -0,0 +1,208 @@
+/**
+ * @file format.c
+ * @author Justin Thwaites
+ * @date 5/20/2020
+ * @brief Integer number formatting for the telemetry strings
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include "format.h"
+#include <string.h>
+
+/***************************************************************************//**
+ * @brief Format module
+ * @details
+ *  Fixed point values, such as temperatures in hundredths of a degree, are
+ *  written as decimal strings with integer math only.  Using these functions
+ *  instead of sprintf("%f") lets the build drop the newlib float printf support.
+ *  Every function writes a NUL terminated string and returns the number of
+ *  characters written without the NUL, so fields can be appended one after another.
+ *
+ ******************************************************************************/
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *	Writes the digits of a value, padded with leading zeros to a minimum count.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ ******************************************************************************/
+static uint32_t format_digits(char *buf, uint32_t value, uint32_t min_digits){
+	char digits[FORMAT_UINT_MAX_LEN];
+	uint32_t count = 0;
+	uint32_t len = 0;
+
+	do{
+		digits[count++] = '0' + value % 10;
+		value /= 10;
+	}while(value > 0);
+	while(count < min_digits){
+		digits[count++] = '0';
+	}
+	while(count > 0){
+		buf[len++] = digits[--count];
+	}
+	buf[len] = 0;
+	return len;
+}
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *	Copies a string into the buffer.
+ *
+ * @param[out] *buf
+ *	Receives the NUL terminated string.
+ *
+ * @param[in] *str
+ *	The string to copy.
+ *
+ * @return
+ *	The number of characters written, without the NUL.
+ ******************************************************************************/
+uint32_t format_str(char *buf, const char *str){
+	uint32_t len = strlen(str);
+
+	memcpy(buf, str, len + 1);
+	return len;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Writes an unsigned value in decimal, like "%lu".
+ *
+ * @param[out] *buf
+ *	Receives at most FORMAT_UINT_MAX_LEN characters and the NUL.
+ *
+ * @return
+ *	The number of characters written, without the NUL.
+ ******************************************************************************/
+uint32_t format_uint(char *buf, uint32_t value){
+	return format_digits(buf, value, 1);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Writes a signed value in decimal, like "%ld".
+ *
+ * @param[out] *buf
+ *	Receives at most FORMAT_INT_MAX_LEN characters and the NUL.
+ *
+ * @return
+ *	The number of characters written, without the NUL.
+ ******************************************************************************/
+uint32_t format_int(char *buf, int32_t value){
+	if(value < 0){
+		buf[0] = '-';
+		return 1 + format_digits(buf + 1, -(uint32_t)value, 1);
+	}
+	return format_digits(buf, value, 1);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Writes a fixed point value with a decimal point, like "%*.*f".
+ *
+ * @details
+ *	The value is an integer count of 10^-decimals units, so 7250 with 2 decimals is
+ *	written as "72.50".  The string is padded with leading spaces to the width.
+ *
+ * @param[out] *buf
+ *	Receives the NUL terminated string.
+ *
+ * @param[in] value
+ *	The value in 10^-decimals units.
+ *
+ * @param[in] decimals
+ *	Digits after the decimal point, at most FORMAT_MAX_DECIMALS.  0 writes no decimal point.
+ *
+ * @param[in] width
+ *	The minimum number of characters.
+ *
+ * @return
+ *	The number of characters written, without the NUL.
+ ******************************************************************************/
+uint32_t format_fixed(char *buf, int32_t value, uint32_t decimals, uint32_t width){
+	char field[FORMAT_INT_MAX_LEN + 2];
+	uint32_t magnitude = value < 0 ? -(uint32_t)value : (uint32_t)value;
+	uint32_t scale = 1;
+	uint32_t len = 0;
+	uint32_t pad;
+
+	EFM_ASSERT(decimals <= FORMAT_MAX_DECIMALS);
+	for(uint32_t i = 0; i < decimals; i++){
+		scale *= 10;
+	}
+	if(value < 0){
+		field[len++] = '-';
+	}
+	len += format_digits(field + len, magnitude / scale, 1);
+	if(decimals > 0){
+		field[len++] = '.';
+		len += format_digits(field + len, magnitude % scale, decimals);
+	}
+	pad = width > len ? width - len : 0;
+	memset(buf, ' ', pad);
+	memcpy(buf + pad, field, len + 1);
+	return pad + len;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Divides and rounds half away from zero, as printf rounds a value it shortens.
+ *
+ * @param[in] value
+ *	The value to divide.
+ *
+ * @param[in] divisor
+ *	A positive divisor, such as 10 to turn hundredths into tenths.
+ *
+ * @return
+ *	The rounded quotient.
+ ******************************************************************************/
+int32_t format_round_div(int32_t value, int32_t divisor){
+	EFM_ASSERT(divisor > 0);
+	if(value < 0){
+		return -((-value + divisor / 2) / divisor);
+	}
+	return (value + divisor / 2) / divisor;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	This function tests the formatting against the strings printf would write.
+ *
+ * @details
+ *	Covers zero, the 32 bit limits, negative values between -1 and 0, padding,
+ *	and rounding of a temperature from hundredths to tenths.
+ *
+ * @note
+ *	This function is a test and should only be called once.
+ ******************************************************************************/
+void format_test(void){
+	char buf[FORMAT_TEST_SIZE];
+
+	EFM_ASSERT(format_uint(buf, 0) == 1 && strcmp(buf, "0") == 0);
+	EFM_ASSERT(format_uint(buf, 4294967295u) == 10 && strcmp(buf, "4294967295") == 0);
+	EFM_ASSERT(format_int(buf, -2147483647 - 1) == 11 && strcmp(buf, "-2147483648") == 0);
+	EFM_ASSERT(format_int(buf, 42) == 2 && strcmp(buf, "42") == 0);
+	EFM_ASSERT(format_fixed(buf, 725, 1, 4) == 4 && strcmp(buf, "72.5") == 0);
+	EFM_ASSERT(format_fixed(buf, 50, 1, 4) == 4 && strcmp(buf, " 5.0") == 0);
+	EFM_ASSERT(format_fixed(buf, -3, 1, 4) == 4 && strcmp(buf, "-0.3") == 0);
+	EFM_ASSERT(format_fixed(buf, 1005, 2, 0) == 5 && strcmp(buf, "10.05") == 0);
+	EFM_ASSERT(format_fixed(buf, 7, 0, 3) == 3 && strcmp(buf, "  7") == 0);
+	EFM_ASSERT(format_round_div(7254, 10) == 725);
+	EFM_ASSERT(format_round_div(7255, 10) == 726);
+	EFM_ASSERT(format_round_div(-4685, 10) == -469);
+	EFM_ASSERT(format_round_div(-4684, 10) == -468);
+}
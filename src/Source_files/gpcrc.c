@@ -0,0 +1,68 @@
+/**
+ * @file gpcrc.c
+ * @author Justin Thwaites
+ * @date 5/6/2020
+ * @brief Contains the driver for the General Purpose CRC peripheral
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include "em_cmu.h"
+#include "em_assert.h"
+#include "gpcrc.h"
+
+//***********************************************************************************
+// functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *	Sets up the GPCRC peripheral to compute CRC-16/CCITT-FALSE.
+ *
+ * @details
+ *	The GPCRC natively shifts data LSB first, so the input bits are reversed to
+ *	get the MSB first CCITT CRC and the result is read back bit reversed.
+ *
+ * @note
+ *	This function only needs to be called once during setup.
+ *
+ ******************************************************************************/
+void gpcrc_open(void){
+	GPCRC_Init_TypeDef gpcrc_values = GPCRC_INIT_DEFAULT;
+
+	CMU_ClockEnable(cmuClock_GPCRC, true);
+
+	gpcrc_values.crcPoly = CRC16_POLY;
+	gpcrc_values.initValue = CRC16_INIT;
+	gpcrc_values.reverseBits = true;
+	gpcrc_values.enableByteMode = true;
+	gpcrc_values.autoInit = false;
+	gpcrc_values.enable = true;
+	GPCRC_Init(GPCRC, &gpcrc_values);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Computes the CRC-16 of a block of bytes with the GPCRC peripheral.
+ *
+ * @param[in] *data
+ *	The bytes to run through the CRC.
+ *
+ * @param[in] len
+ *	The number of bytes.
+ *
+ * @return
+ *	The 16 bit CRC of the block.
+ *
+ * @note
+ *	The peripheral is shared, so this function must not be called from an interrupt.
+ ******************************************************************************/
+uint16_t gpcrc_crc16(const uint8_t *data, uint32_t len){
+	GPCRC_Start(GPCRC);
+	for(uint32_t i = 0; i < len; i++){
+		GPCRC_InputU8(GPCRC, data[i]);
+	}
+	return GPCRC_DataReadBitReversed(GPCRC);
+}
@@ -31,9 +31,7 @@
 //***********************************************************************************
 // private variables
 //***********************************************************************************
-static uint32_t scheduled_comp0_evt;
-static uint32_t scheduled_comp1_evt;
-static uint32_t scheduled_uf_evt;
+static LETIMER_CONTEXT contexts[LETIMER_INSTANCES];
 
 //***********************************************************************************
 // global variables
@@ -44,6 +42,74 @@ static uint32_t scheduled_uf_evt;
 // functions
 //***********************************************************************************
 
+/***************************************************************************//**
+ * @brief
+ *	Returns the driver context of an LETIMER instance.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ ******************************************************************************/
+static LETIMER_CONTEXT *letimer_context(LETIMER_TypeDef *letimer){
+#if defined(LETIMER1)
+	if(letimer == LETIMER1) return &contexts[1];
+#endif
+	EFM_ASSERT(letimer == LETIMER0);
+	return &contexts[0];
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Converts a time in us to LETIMER ticks at the prescaled LFA clock, rounded to the nearest tick.
+ *
+ * @details
+ *	Integer math only, so 3100000 us at 1000 Hz is exactly 3100 ticks.  The product is
+ *	done in 64 bits, so any 32 bit time at any LFA clock is converted without overflow.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ ******************************************************************************/
+static uint32_t letimer_us_to_ticks(LETIMER_CONTEXT *ctx, uint32_t us){
+	return LETIMER_US_TO_TICKS(us, ctx->lfa_hz, ctx->prescaler);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Returns the smallest prescaler, for the finest tick, that fits a period in COMP0.
+ *
+ * @details
+ *	COMP0 is 16 bits, so at the 1000 Hz ULFRCO a period up to 65.5 s needs no prescaler,
+ *	while at the 32768 Hz LFXO a period longer than 2 s does.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ ******************************************************************************/
+static uint32_t letimer_prescaler(uint32_t clock_hz, uint32_t max_period){
+	for(uint32_t div = 1; div <= LETIMER_MAX_PRESCALER; div <<= 1){
+		if(LETIMER_US_TO_TICKS(max_period, clock_hz, div) <= LETIMER_MAX_TICKS) return div;
+	}
+	EFM_ASSERT(false);		// longer than the LETIMER can count at this clock
+	return LETIMER_MAX_PRESCALER;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Adds the ticks of a completed period to the ms timestamp.
+ *
+ * @details
+ *	The ms are kept as a whole part and a remainder in 1 / lfa_hz ms, so periods that are
+ *	not a whole number of ms, on the LFXO for example, add up without drifting.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.  It is called
+ *	from the UF interrupt.
+ ******************************************************************************/
+static void letimer_add_period(LETIMER_CONTEXT *ctx, uint32_t ticks){
+	uint64_t frac = ctx->ms_frac + (uint64_t)ticks * ctx->prescaler * LETIMER_MS_PER_S;
+
+	ctx->ms_base += frac / ctx->lfa_hz;
+	ctx->ms_frac = frac % ctx->lfa_hz;
+}
+
 /***************************************************************************//**
  * @brief
  *   Driver to open an set an LETIMER peripheral in PWM mode
@@ -71,15 +137,30 @@ static uint32_t scheduled_uf_evt;
 
 void letimer_pwm_open(LETIMER_TypeDef *letimer, APP_LETIMER_PWM_TypeDef *app_letimer_struct){
 	LETIMER_Init_TypeDef letimer_pwm_values;
+	LETIMER_CONTEXT *ctx = letimer_context(letimer);
 
 	//Must disable the letimer in case it is currently running
 	letimer_start(letimer, DISABLE_LETIMER);
 
-	/*  Enable the routed clock to the LETIMER0 peripheral */
-
+	/*  Enable the routed clock to the LETIMER peripheral */
 	if(letimer == LETIMER0){
-		CMU_ClockEnable(cmuClock_LETIMER0, true);
+		ctx->clock = cmuClock_LETIMER0;
+		ctx->irq = LETIMER0_IRQn;
 	}
+#if defined(LETIMER1)
+	if(letimer == LETIMER1){
+		ctx->clock = cmuClock_LETIMER1;
+		ctx->irq = LETIMER1_IRQn;
+	}
+#endif
+	CMU_ClockEnable(ctx->clock, true);
+
+	/* Pick the prescaler from the actual LFA clock so the longest period fits COMP0 */
+	EFM_ASSERT(app_letimer_struct->period <= app_letimer_struct->max_period);
+	ctx->lfa_hz = CMU_ClockFreqGet(cmuClock_LFA);
+	EFM_ASSERT(ctx->lfa_hz > 0);
+	ctx->prescaler = letimer_prescaler(ctx->lfa_hz, app_letimer_struct->max_period);
+	CMU_ClockDivSet(ctx->clock, ctx->prescaler);
 
 	/* Use EFM_ASSERT statements to verify whether the LETIMER clock tree is properly
 	 * configured and enabled
@@ -116,8 +197,18 @@ void letimer_pwm_open(LETIMER_TypeDef *letimer, APP_LETIMER_PWM_TypeDef *app_let
 	/* Calculate the value of COMP0 and COMP1 and load these control registers
 	 * with the calculated values
 	 */
-	LETIMER_CompareSet(letimer, 0, app_letimer_struct->period * LETIMER_HZ );
-	LETIMER_CompareSet(letimer, 1, app_letimer_struct->active_period * LETIMER_HZ );
+	ctx->requested_period = app_letimer_struct->period;
+	ctx->requested_ticks = letimer_us_to_ticks(ctx, ctx->requested_period);
+	EFM_ASSERT(ctx->requested_ticks >= LETIMER_MIN_TICKS);
+	EFM_ASSERT(letimer_us_to_ticks(ctx, app_letimer_struct->active_period) < ctx->requested_ticks);
+	LETIMER_CompareSet(letimer, 0, ctx->requested_ticks - 1);		// counts COMP0 down to 0, COMP0 + 1 ticks
+	LETIMER_CompareSet(letimer, 1, letimer_us_to_ticks(ctx, app_letimer_struct->active_period));
+	ctx->ms_base = 0;
+	ctx->ms_frac = 0;
+	ctx->period_top = ctx->requested_ticks - 1;
+	ctx->reload_top = ctx->period_top;
+	ctx->staged = false;
+	ctx->comp1_pending = false;
 
 
 	/* Set the REP0 mode bits for PWM operation
@@ -136,10 +227,10 @@ void letimer_pwm_open(LETIMER_TypeDef *letimer, APP_LETIMER_PWM_TypeDef *app_let
 
 	/* We will be enabling the interrupts for this timer*/
 
-	/* Initializing the private variables*/
-	scheduled_comp0_evt = app_letimer_struct->comp0_evt;
-	scheduled_comp1_evt = app_letimer_struct->comp1_evt;
-	scheduled_uf_evt = app_letimer_struct->uf_evt;
+	/* Initializing the driver context of this instance */
+	ctx->comp0_evt = app_letimer_struct->comp0_evt;
+	ctx->comp1_evt = app_letimer_struct->comp1_evt;
+	ctx->uf_evt = app_letimer_struct->uf_evt;
 
 
 	//clears only desired interrupts
@@ -154,7 +245,7 @@ void letimer_pwm_open(LETIMER_TypeDef *letimer, APP_LETIMER_PWM_TypeDef *app_let
 	while(letimer->SYNCBUSY);
 
 
-	NVIC_EnableIRQ(LETIMER0_IRQn);
+	NVIC_EnableIRQ(ctx->irq);
 }
 
 /***************************************************************************//**
@@ -192,37 +283,179 @@ void letimer_start(LETIMER_TypeDef *letimer, bool enable){
 
 /***************************************************************************//**
  * @brief
- *	This is the IRQ handler for the LETIMER0 , adding events to the event scheduler.
+ *	Services the interrupts of an LETIMER instance, adding its events to the event scheduler.
  *
  * @details
- * 	The IRQ handler first reads the interrupt register, and then clears the interrupt. Then the IRQ handler uses if statements to determine
- * 	Which events get scheduled.
+ * 	The handler first reads the interrupt register, and then clears the interrupt. Then it uses if statements
+ * 	to determine which events of the instance get scheduled.  On an underflow a period requested by
+ * 	letimer_set_period() is moved one step further into the registers, see letimer_set_period().
  *
  * @note
- * 	This function is automatically called when an LETIMER0 interrupt occurs.
- *
- *
+ *	This function is a private helper function that only has local scope.  It is called from the IRQ
+ *	handler of each instance.
  ******************************************************************************/
-void LETIMER0_IRQHandler(void){
+static void letimer_irq(LETIMER_TypeDef *letimer){
+	LETIMER_CONTEXT *ctx = letimer_context(letimer);
 	uint32_t int_flag;
-	int_flag = LETIMER0->IF & LETIMER0->IEN;
-	LETIMER0->IFC = int_flag;
+	int_flag = letimer->IF & letimer->IEN;
+	letimer->IFC = int_flag;
 	if(int_flag & LETIMER_IF_COMP0){
 //		COMP0 ISR
-		EFM_ASSERT(!(LETIMER0->IF & LETIMER_IF_COMP0));
-		add_scheduled_event(scheduled_comp0_evt);
+		EFM_ASSERT(!(letimer->IF & LETIMER_IF_COMP0));
+		add_scheduled_event(ctx->comp0_evt);
 	}
 	if(int_flag & LETIMER_IF_COMP1){
 //		COMP1 ISR
-		EFM_ASSERT(!(LETIMER0->IF & LETIMER_IF_COMP1));
-		add_scheduled_event(scheduled_comp1_evt);
+		EFM_ASSERT(!(letimer->IF & LETIMER_IF_COMP1));
+		add_scheduled_event(ctx->comp1_evt);
 	}
 	if(int_flag & LETIMER_IF_UF){
 //		UF ISR
-		EFM_ASSERT(!(LETIMER0->IF & LETIMER_IF_UF));
-		add_scheduled_event(scheduled_uf_evt);
+		EFM_ASSERT(!(letimer->IF & LETIMER_IF_UF));
+		letimer_add_period(ctx, ctx->period_top + 1);
+		ctx->period_top = ctx->reload_top;
+		if(ctx->comp1_pending){
+			LETIMER_CompareSet(letimer, 1, ctx->comp1_next);	// CNT was just reloaded, above the new COMP1
+			ctx->comp1_pending = false;
+		}
+		if(ctx->staged){
+			LETIMER_CompareSet(letimer, 0, ctx->staged_top);	// loaded into CNT at the next underflow
+			ctx->reload_top = ctx->staged_top;
+			ctx->comp1_next = ctx->staged_active;
+			ctx->comp1_pending = true;
+			ctx->staged = false;
+		}
+		add_scheduled_event(ctx->uf_evt);
 	}
+}
 
+/***************************************************************************//**
+ * @brief
+ *	These are the IRQ handlers of the LETIMER instances.
+ *
+ * @details
+ * 	Each instance has its own driver context, so the handlers only pass on which instance interrupted.
+ *
+ * @note
+ * 	These functions are automatically called when an LETIMER interrupt occurs.
+ *
+ ******************************************************************************/
+void LETIMER0_IRQHandler(void){
+	letimer_irq(LETIMER0);
+}
+
+#if defined(LETIMER1)
+void LETIMER1_IRQHandler(void){
+	letimer_irq(LETIMER1);
+}
+#endif
+
+/***************************************************************************//**
+ * @brief
+ *	Returns a free running timestamp in ms.
+ *
+ * @details
+ *	The timestamp is the ms of the completed periods, added up by the UF interrupt, plus
+ *	the ticks counted down in the current period converted to ms.  The sum is read again
+ *	after the CNT register so an underflow in between is not missed.  Periods changed with
+ *	letimer_set_period() are counted with their own length, and the conversion uses the
+ *	actual LFA clock and prescaler.
+ *
+ * @note
+ *	The UF interrupt must be enabled, and the timestamp does not advance while the LETIMER
+ *	is stopped.  An underflow that is still pending because interrupts are disabled is not
+ *	counted yet.  The timestamp wraps after 49.7 days.
+ *
+ * @param[in] letimer
+ *   Pointer to the base peripheral address of the LETIMER peripheral
+ *
+ * @return
+ *	The timestamp in ms.
+ ******************************************************************************/
+uint32_t letimer_ms(LETIMER_TypeDef *letimer){
+	LETIMER_CONTEXT *ctx = letimer_context(letimer);
+	uint32_t base;
+	uint32_t frac;
+	uint32_t cnt;
+	uint32_t top;
+
+	do{
+		base = ctx->ms_base;
+		frac = ctx->ms_frac;
+		top = ctx->period_top;
+		cnt = letimer->CNT;
+	}while(base != ctx->ms_base || frac != ctx->ms_frac);
+	return base + (frac + (uint64_t)(top - cnt) * ctx->prescaler * LETIMER_MS_PER_S) / ctx->lfa_hz;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Changes the PWM period and active time of a running LETIMER without stopping it.
+ *
+ * @details
+ *	letimer_pwm_open() stops the timer, checks the clock tree again and re-enables the IRQ,
+ *	so it is only used once.  This function instead stages the new values for the UF
+ *	interrupt.  COMP0 is only the value CNT is reloaded with, so the UF interrupt writes it
+ *	at the next underflow and the period after the following underflow has the new length.
+ *	COMP1 is written at that following underflow, just after CNT is reloaded with the new
+ *	period, so no period sees an active time that is longer than itself and the output and
+ *	COMP1 events never skip or repeat.  letimer_ms() stays continuous across the change.
+ *	The times are rounded to whole ticks of the prescaler chosen when the LETIMER was
+ *	opened, see letimer_period_error().
+ *
+ * @note
+ *	A second call before the first change reaches the registers replaces it.  The UF
+ *	interrupt must be enabled.
+ *
+ * @param[in] letimer
+ *   Pointer to the base peripheral address of the LETIMER peripheral
+ *
+ * @param[in] period
+ *	The new period in us, at most the max_period the LETIMER was opened with.
+ *
+ * @param[in] active_period
+ *	The new active time in us, shorter than the period.
+ *
+ * @return
+ *	false if the period is too long for the prescaler or too short to count, or if the
+ *	active time is not shorter than the period.
+ ******************************************************************************/
+bool letimer_set_period(LETIMER_TypeDef *letimer, uint32_t period, uint32_t active_period){
+	LETIMER_CONTEXT *ctx = letimer_context(letimer);
+	uint32_t ticks = letimer_us_to_ticks(ctx, period);
+	uint32_t active = letimer_us_to_ticks(ctx, active_period);
+
+	EFM_ASSERT(letimer->IEN & LETIMER_IEN_UF);
+	if(ticks < LETIMER_MIN_TICKS || ticks > LETIMER_MAX_TICKS || active >= ticks) return false;
+	__disable_irq();
+	ctx->staged_top = ticks - 1;
+	ctx->staged_active = active;
+	ctx->staged = true;
+	ctx->requested_period = period;
+	ctx->requested_ticks = ticks;
+	__enable_irq();
+	return true;
 }
 
+/***************************************************************************//**
+ * @brief
+ *	Returns how far the last requested period is from the period the LETIMER counts.
+ *
+ * @details
+ *	A period is a whole number of ticks of the prescaled LFA clock, so, for example, 3.1 s
+ *	on the 32768 Hz LFXO with a prescaler of 32 is 3174 ticks, 3.0996 s, an error of
+ *	-391 us.  On the 1000 Hz ULFRCO whole ms have no error beyond the tolerance of the
+ *	oscillator itself, which this does not include.
+ *
+ * @param[in] letimer
+ *   Pointer to the base peripheral address of the LETIMER peripheral
+ *
+ * @return
+ *	The achieved period less the requested period, in ns.
+ ******************************************************************************/
+int32_t letimer_period_error(LETIMER_TypeDef *letimer){
+	LETIMER_CONTEXT *ctx = letimer_context(letimer);
+	uint64_t achieved = (uint64_t)ctx->requested_ticks * ctx->prescaler * LETIMER_NS_PER_S / ctx->lfa_hz;
 
+	return (int64_t)achieved - (int64_t)ctx->requested_period * LETIMER_NS_PER_US;
+}
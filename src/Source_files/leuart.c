@@ -30,9 +30,13 @@
 //***********************************************************************************
 static uint32_t	rx_done_evt;
 static uint32_t	tx_done_evt;
+static uint32_t	route_pen;
 
 
 static LEUART_PAYLOAD payload;
+static SPSC_RING rx_queue;
+static uint8_t rx_queue_storage[LEUART_RX_QUEUE_SIZE];
+static bool raw_saved_delimited;		// reception mode restored when raw reception ends
 
 /***************************************************************************//**
  * @brief LEUART driver
@@ -57,12 +61,73 @@ static LEUART_PAYLOAD payload;
 // Global functions
 //***********************************************************************************
 
+/***************************************************************************//**
+ * @brief
+ *	Queues a completed message for the main loop and schedules the rx done event.
+ *
+ * @details
+ *	The ISR is the only producer of the RX queue and leuart_rx_read() the only consumer, so
+ *	a message that arrives before the previous one has been handled is queued behind it
+ *	instead of overwriting it.  A message that does not fit is counted and dropped.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ *******************************************************************************/
+static void leuart_rx_queue(uint32_t len){
+	if(!spsc_ring_write_record(&rx_queue, payload.rx_message, len)){
+		payload.rx_dropped++;
+	}
+	add_scheduled_event(rx_done_evt);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Matches a received byte against the watched patterns.
+ *
+ * @details
+ *	A byte that does not fit a pattern restarts its match.  A completed pattern is queued as
+ *	a message of its own, and a binary frame in progress is discarded since the pattern was
+ *	received in front of it.
+ *
+ * @return
+ *	true if the byte completed a pattern and must not be received as data.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ *******************************************************************************/
+static bool leuart_rx_watch_match(char data){
+	for(int i = 0; i < payload.watch_count; i++){
+		const char *pattern = payload.watch[i];
+		uint32_t *match = &payload.watch_match[i];
+
+		if(data == pattern[*match]){
+			(*match)++;
+		}
+		else{
+			*match = (data == pattern[0]);
+		}
+		if(pattern[*match] == 0){
+			*match = 0;
+			if(!spsc_ring_write_record(&rx_queue, pattern, strlen(pattern))){
+				payload.rx_dropped++;
+			}
+			add_scheduled_event(rx_done_evt);
+			if(payload.rx_delimited) payload.rx_index = 0;
+			return true;
+		}
+	}
+	return false;
+}
+
 /***************************************************************************//**
  * @brief
  * 	Called as an IRQ handler for the RXDATAV interrupt.
  *
  * @details
- *	This function only operates if in receive data state or on reset state. If in the receive data
+ *	Every byte is first matched against the watched patterns, see leuart_rx_watch().
+ *	In raw mode every byte is queued as a message of its own.
+ *	In delimited mode every byte up to the delimiter is stored and the delimiter completes the message.
+ *	Otherwise this function only operates if in receive data state or on reset state. If in the receive data
  *	state, the character is written and index increased. If in the Reset state, this means the piece
  *	of data is the signal frame: ";", so there is a full reset of the state machine and RX Block is enabled again.
  *
@@ -71,24 +136,46 @@ static LEUART_PAYLOAD payload;
  *
  *******************************************************************************/
 void leuart_rxdatav(){
+	char data;
+
+	data = payload.leuart->RXDATA;
+	if(leuart_rx_watch_match(data)) return;
+	if(payload.rx_raw){
+		payload.rx_message[0] = data;
+		payload.rx_message[1] = 0;
+		leuart_rx_queue(1);
+		return;
+	}
+	if(payload.rx_delimited){
+		if(data == LEUART_RX_DELIMITER){
+			payload.rx_message[payload.rx_index] = 0;
+			leuart_rx_queue(payload.rx_index);
+			payload.rx_index = 0;
+		}
+		else if(payload.rx_index < LEUART_MSG_SIZE - 1){
+			payload.rx_message[payload.rx_index++] = data;
+		}
+		return;
+	}
 
 	switch(payload.rx_state){
 		case 	WAIT:
-			EFM_ASSERT(false);
+			EFM_ASSERT(payload.watch_count > 0); // only unblocked outside a frame for the watched patterns
 			break;
 
 		case RECIEVE_DATA:
-			payload.rx_message[payload.rx_index++] = payload.leuart->RXDATA;
+			payload.rx_message[payload.rx_index++] = data;
 			break;
 
 		case RESET: // called after receiving a signal frame. This is to clear any remaining data and reset the state machine.
-			payload.rxbusy = false;
-			payload.leuart->RXDATA; // clears excess data (sig frame character)
-			payload.leuart->CMD = LEUART_CMD_RXBLOCKEN;
+			payload.rxbusy = false;	// data is the sig frame character
+			if(payload.watch_count == 0){
+				payload.leuart->CMD = LEUART_CMD_RXBLOCKEN;
+			}
 			payload.rx_state = WAIT;
 			while(payload.leuart->SYNCBUSY);
 
-			add_scheduled_event(rx_done_evt);
+			leuart_rx_queue(strlen(payload.rx_message));
 			break;
 
 		default:
@@ -175,17 +262,29 @@ void leuart_startf(){
 }
 /***************************************************************************//**
  * @brief
- *	This returns the rx_message
+ *	Takes the oldest received message off the RX queue.
  *
  * @details
- *	This returns the character pointer that is the start of the rx_message array.
+ *	The message is copied out of the queue and NUL terminated, so it stays valid while
+ *	the ISR keeps receiving.
  *
  * @note
- * 	This function is meant to allow outside functions to access private data
+ * 	This function is meant to allow outside functions to access private data.  It must only
+ * 	be called from the main loop.
+ *
+ *@param[out] *message
+ * A LEUART_MSG_SIZE array that receives the message.
+ *
+ *@return
+ * false if no message is waiting.
  *
  *******************************************************************************/
-char* leuart_rxmessage(void){
-	return payload.rx_message;
+bool leuart_rx_read(char *message){
+	uint32_t len;
+
+	if(!spsc_ring_read_record(&rx_queue, message, LEUART_MSG_SIZE - 1, &len)) return false;
+	message[len] = 0;
+	return true;
 }
 /***************************************************************************//**
  * @brief	This function acts as the test driven development to make sure that the RX buffer is setup
@@ -309,6 +408,7 @@ void leuart_rxtest(LEUART_TypeDef *leuart){
 	EFM_ASSERT(payload.rx_message[strlen(myarr5)] == 0);
 
 	remove_scheduled_event(rx_done_evt);
+	spsc_ring_init(&rx_queue, rx_queue_storage, LEUART_RX_QUEUE_SIZE);	// drops the test messages
 	leuart->CTRL &= ~LEUART_CTRL_LOOPBK;
 	while(leuart->SYNCBUSY);
 }
@@ -341,7 +441,117 @@ void leuart_rxsetup(LEUART_TypeDef *leuart){
 	//	LEUART_IntClear(leuart, LEUART_IFC_SIGF|LEUART_IFC_STARTF);
 	//	LEUART_IntEnable(leuart, LEUART_IEN_RXDATAV|LEUART_IEN_SIGF|LEUART_IEN_STARTF);
 	payload.rxbusy = false;
+	payload.rx_delimited = false;
+	payload.rx_raw = false;
+	payload.watch_count = 0;
+	payload.rx_dropped = 0;
 	payload.leuart = leuart;
+	spsc_ring_init(&rx_queue, rx_queue_storage, LEUART_RX_QUEUE_SIZE);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Switches the receiver between start/signal frame reception and delimited reception.
+ *
+ * @details
+ *	Delimited reception is used for binary frames.  The RX buffer is unblocked and the start
+ *	and signal frame interrupts are disabled so every byte is received, and a message ends at
+ *	LEUART_RX_DELIMITER.  Turning delimited reception off restores the setup of leuart_rxsetup(), with
+ *	the RX buffer left unblocked if patterns are watched.
+ *
+ * @note
+ *	With the RX buffer unblocked every received byte wakes the CPU.
+ *
+ *@param[in] *leuart
+ * This is the pointer to the registers of the LEUART
+ *
+ *@param[in] enable
+ * true for delimited reception, false for start/signal frame reception
+ *
+ *******************************************************************************/
+
+void leuart_rx_delimited(LEUART_TypeDef *leuart, bool enable){
+	__disable_irq();
+	if(enable){
+		LEUART_IntDisable(leuart, LEUART_IEN_STARTF | LEUART_IEN_SIGF);
+		leuart_cmd_write(leuart, LEUART_CMD_RXBLOCKDIS | LEUART_CMD_CLEARRX);
+		payload.rx_state = RECIEVE_DATA;
+	}
+	else{
+		leuart_cmd_write(leuart, (payload.watch_count > 0 ? 0 : LEUART_CMD_RXBLOCKEN) | LEUART_CMD_CLEARRX);
+		LEUART_IntClear(leuart, LEUART_IFC_STARTF | LEUART_IFC_SIGF);
+		LEUART_IntEnable(leuart, LEUART_IEN_STARTF);
+		payload.rx_state = WAIT;
+	}
+	payload.rx_index = 0;
+	payload.rxbusy = false;
+	payload.rx_delimited = enable;
+	__enable_irq();
+}
+/***************************************************************************//**
+ * @brief
+ *	Adds a pattern that is matched in the received byte stream in every reception mode.
+ *
+ * @details
+ *	Used for the unframed notifications of the HM10, such as OK+CONN, which arrive outside of
+ *	the start/signal frames.  When the pattern has been received it is queued as a message and
+ *	the rx done event is scheduled.  The RX buffer is unblocked so bytes outside of a frame are
+ *	received.
+ *
+ * @note
+ *	With the RX buffer unblocked every received byte wakes the CPU, but outside of a frame the
+ *	HM10 only sends its notifications.  The pattern must stay valid while the LEUART is open.
+ *
+ *@param[in] *leuart
+ * This is the pointer to the registers of the LEUART
+ *
+ *@param[in] *pattern
+ * The NUL terminated pattern, at most LEUART_RX_WATCHES patterns may be added.
+ *
+ *******************************************************************************/
+
+void leuart_rx_watch(LEUART_TypeDef *leuart, const char *pattern){
+	EFM_ASSERT(payload.watch_count < LEUART_RX_WATCHES);
+	__disable_irq();
+	payload.watch[payload.watch_count] = pattern;
+	payload.watch_match[payload.watch_count] = 0;
+	payload.watch_count++;
+	leuart_cmd_write(leuart, LEUART_CMD_RXBLOCKDIS);
+	__enable_irq();
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Switches the receiver to raw reception, where every byte is queued as it arrives.
+ *
+ * @details
+ *	Raw reception is used for the HM10 AT responses, which have neither start/signal frames
+ *	nor a delimiter.  The receiver is set up as for delimited reception, and turning raw
+ *	reception off restores the mode that was active before.
+ *
+ * @note
+ *	Every received byte takes a record of the RX queue and an rx done event, so raw reception
+ *	should only be left on while a response is expected.
+ *
+ *@param[in] *leuart
+ * This is the pointer to the registers of the LEUART
+ *
+ *@param[in] enable
+ * true for raw reception, false to restore the previous reception mode
+ *
+ *******************************************************************************/
+
+void leuart_rx_raw(LEUART_TypeDef *leuart, bool enable){
+	if(enable == payload.rx_raw) return;
+	if(enable){
+		raw_saved_delimited = payload.rx_delimited;
+		payload.rx_raw = true;
+		leuart_rx_delimited(leuart, true);
+	}
+	else{
+		payload.rx_raw = false;
+		leuart_rx_delimited(leuart, raw_saved_delimited);
+	}
 }
 /***************************************************************************//**
  * @brief
@@ -396,7 +606,8 @@ void leuart_open(LEUART_TypeDef *leuart, LEUART_OPEN_STRUCT *leuart_settings){
 
 	leuart->ROUTELOC0 = leuart_settings->rx_loc | leuart_settings->tx_loc;
 // LEUART_ROUTELOC0_RXLOC_LOC18
-	leuart->ROUTEPEN = (leuart_settings->rx_pin_en * LEUART_ROUTEPEN_RXPEN  | leuart_settings->tx_pin_en * LEUART_ROUTEPEN_TXPEN );
+	route_pen = (leuart_settings->rx_pin_en * LEUART_ROUTEPEN_RXPEN  | leuart_settings->tx_pin_en * LEUART_ROUTEPEN_TXPEN );
+	leuart->ROUTEPEN = route_pen;
 
 	while(leuart->SYNCBUSY);
 	if(leuart_settings->enable){
@@ -451,6 +662,11 @@ static void leuart_txbl(void){
 		case SEND_DATA:
 			if(payload.index < payload.message_len){
 				LEUART0->TXDATA = payload.message[payload.index++];
+				while(payload.index >= payload.message_len && ++payload.segment < payload.segment_count){
+					payload.message = payload.segments[payload.segment].data;	// next message of the burst
+					payload.message_len = payload.segments[payload.segment].len;
+					payload.index = 0;
+				}
 				if(payload.index >= payload.message_len){
 					payload.state = FINISH_WAIT;
 					LEUART_IntDisable(payload.leuart, LEUART_IEN_TXBL);
@@ -561,20 +777,52 @@ void LEUART0_IRQHandler(void){
  * This function starts the software state machine for the leuart communication.
  *
  * @details
- * This function copies the inputed character array, and then initializes the state machine and all other state
+ * This function keeps a pointer to the inputed character array, and then initializes the state machine and all other state
  * information, then switches to the second state, and enables the TXBL interrupt.
  *
  * @note
  *	This function should be called every time it is necessary to write a message over the UART communication.
+ *	The message is not copied, so the character array must not change until the tx done event.
  *******************************************************************************/
 
 void leuart_start(LEUART_TypeDef *leuart, char *string, uint32_t string_len){
+	TX_SEGMENT segment;
+
+	segment.data = string;
+	segment.len = string_len;
+	leuart_start_segments(leuart, &segment, 1);
+}
+
+/*****************************************************************************
+ * @brief
+ * This function starts one transfer of several messages.
+ *
+ * @details
+ * The segments are sent back to back by the TXBL interrupt, so the whole burst costs a single
+ * TXC interrupt and tx done event instead of one per message.
+ *
+ * @note
+ *	Only the segment list is copied; the messages must not change until the tx done event.
+ *	The first segment must not be empty.
+ *
+ *@param[in] *segments
+ * The messages to send, in order.
+ *
+ *@param[in] count
+ * The number of segments, at most TX_MAX_SEGMENTS.
+ *******************************************************************************/
+
+void leuart_start_segments(LEUART_TypeDef *leuart, const TX_SEGMENT *segments, uint32_t count){
+	EFM_ASSERT(count > 0 && count <= TX_MAX_SEGMENTS);
 	sleep_block_mode(LEUART_TX_EM);
 //	EFM_ASSERT(leuart_tx_busy(leuart));
 	payload.state = LEUART_INITIALIZE;
 	payload.txbusy = true;
-	payload.message_len = string_len;
-	strcpy(payload.message, string);
+	memcpy(payload.segments, segments, count * sizeof(TX_SEGMENT));
+	payload.segment_count = count;
+	payload.segment = 0;
+	payload.message_len = segments[0].len;
+	payload.message = segments[0].data;
 	payload.index = 0;
 	payload.leuart = leuart;
 	payload.state = SEND_DATA;
@@ -585,6 +833,61 @@ void leuart_start(LEUART_TypeDef *leuart, char *string, uint32_t string_len){
 
 }
 
+/***************************************************************************//**
+ * @brief
+ *   Connects or disconnects the LEUART from its GPIO pins.
+ *
+ * @details
+ * 	 Restores the ROUTEPEN value set up by leuart_open() when enabled and clears it when
+ * 	 disabled, so a different peripheral can take over the same pins without the LEUART
+ * 	 driving the TX line.
+ *
+ * @note
+ *   This function should only be called while the LEUART is not transmitting.
+ *
+ * @param[in] *leuart
+ *   Defines the LEUART peripheral to access.
+ *
+ * @param[in] enable
+ *   true routes the LEUART to its pins, false releases the pins
+ *
+ ******************************************************************************/
+
+void leuart_route(LEUART_TypeDef *leuart, bool enable){
+	EFM_ASSERT(!payload.txbusy);
+	while(leuart->SYNCBUSY);
+	leuart->ROUTEPEN = enable ? route_pen : 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Changes the baud rate of an open LEUART.
+ *
+ * @details
+ * 	 The frame format and routing set up by leuart_open() are kept, so the rate can follow a
+ * 	 device on the other end that has just been switched to a new one.
+ *
+ * @note
+ *   This function should only be called while the LEUART is not transmitting.
+ *
+ * @param[in] *leuart
+ *   Defines the LEUART peripheral to access.
+ *
+ * @param[in] ref_freq
+ *   The reference clock frequency, 0 to use the current LEUART clock.
+ *
+ * @param[in] baudrate
+ *   The new baud rate.
+ *
+ ******************************************************************************/
+
+void leuart_set_baud(LEUART_TypeDef *leuart, uint32_t ref_freq, uint32_t baudrate){
+	EFM_ASSERT(!payload.txbusy);
+	while(leuart->SYNCBUSY);
+	LEUART_BaudrateSet(leuart, ref_freq, baudrate);
+	while(leuart->SYNCBUSY);
+}
+
 /***************************************************************************//**
  * @brief
  *   Returns the private variable that marks if the LEUART is in the middle of a transmission,
@@ -0,0 +1,312 @@
+/**
+ * @file spsc_ring.c
+ * @author Justin Thwaites
+ * @date 5/11/2020
+ * @brief Lock-free single producer, single consumer ring buffer
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include <string.h>
+#include "spsc_ring.h"
+#include "em_assert.h"
+
+/***************************************************************************//**
+ * @brief SPSC ring
+ * @details
+ *  A ring of records that one producer and one consumer may use at the same time without
+ *  disabling interrupts, for example an ISR filling it while the main loop empties it.
+ *  Each side only writes its own index.  The data is written before the head is
+ *  published (release) and the head is read before the data is read (acquire); the
+ *  same holds for the tail in the other direction.
+ *
+ *  The size must be a power of two.  Both indexes run freely and are masked on access,
+ *  so head - tail is the number of filled bytes.
+ *
+ *  Every record is stored behind a 16 bit header, holding its length and three user flag
+ *  bits, and is contiguous in the storage, so the producer can build a record in place with
+ *  spsc_ring_reserve() and the consumer can use it in place with spsc_ring_peek_record().
+ *  Records are padded to SPSC_RECORD_ALIGN so a header never straddles the end of the
+ *  storage.  A record that would run past the end is moved to the start, behind a
+ *  SPSC_RECORD_PAD filler.  A record of up to half the ring size always fits in an empty ring.
+ *
+ ******************************************************************************/
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *	Returns the space a record of len bytes takes up, including its header.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ ******************************************************************************/
+static uint32_t spsc_ring_record_size(uint32_t len){
+	return SPSC_RECORD_HEADER + ((len + SPSC_RECORD_ALIGN - 1) & ~(SPSC_RECORD_ALIGN - 1));
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Reads and writes the little endian header at a position in the storage.
+ *
+ * @note
+ *	These functions are private helper functions that only have local scope.
+ ******************************************************************************/
+static uint32_t spsc_ring_header(SPSC_RING *ring, uint32_t pos){
+	return ring->buf[pos] | (ring->buf[pos + 1] << 8);
+}
+
+static void spsc_ring_set_header(SPSC_RING *ring, uint32_t pos, uint32_t header){
+	ring->buf[pos] = header & 0xFF;
+	ring->buf[pos + 1] = header >> 8;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Makes len bytes written behind the head visible to the consumer.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ ******************************************************************************/
+static void spsc_ring_publish(SPSC_RING *ring, uint32_t len){
+	SPSC_BARRIER();		// release: the data must be written before the new head is seen
+	ring->head = ring->head + len;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Gives len bytes at the tail back to the producer.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ ******************************************************************************/
+static void spsc_ring_release(SPSC_RING *ring, uint32_t len){
+	SPSC_BARRIER();		// release: the data must be read before the producer may overwrite it
+	ring->tail = ring->tail + len;
+}
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *	Initializes an empty ring over the storage provided by the caller.
+ *
+ * @note
+ *	Must not be called while the producer or the consumer may be using the ring.
+ *
+ * @param[in] *ring
+ *	The ring to initialize.
+ *
+ * @param[in] *storage
+ *	The byte array holding the ring data.
+ *
+ * @param[in] size
+ *	The size of the storage, which must be a power of two.
+ ******************************************************************************/
+void spsc_ring_init(SPSC_RING *ring, uint8_t *storage, uint32_t size){
+	EFM_ASSERT(size >= SPSC_RECORD_ALIGN && (size & (size - 1)) == 0);
+	ring->buf = storage;
+	ring->mask = size - 1;
+	ring->head = 0;
+	ring->tail = 0;
+	ring->pad = 0;
+	ring->reserved = 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Returns the number of bytes in the ring, including record headers and filler.
+ *
+ * @details
+ *	The count may only grow when called by the consumer and only shrink when called by the
+ *	producer, so it is safe for either side to act on it.
+ ******************************************************************************/
+uint32_t spsc_ring_count(SPSC_RING *ring){
+	uint32_t count = ring->head - ring->tail;
+	SPSC_BARRIER();		// acquire: later data accesses can not move before the index read
+	return count;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Returns the number of free bytes in the ring.
+ ******************************************************************************/
+uint32_t spsc_ring_space(SPSC_RING *ring){
+	return ring->mask + 1 - spsc_ring_count(ring);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Reserves a contiguous record of up to len bytes.  Called by the producer only.
+ *
+ * @details
+ *	Nothing is visible to the consumer until spsc_ring_commit() is called.  Reserving
+ *	again before committing replaces the earlier reservation.
+ *
+ * @return
+ *	A pointer to len writable bytes inside the ring, or NULL if the record does not fit.
+ ******************************************************************************/
+void *spsc_ring_reserve(SPSC_RING *ring, uint32_t len){
+	uint32_t pos = ring->head & ring->mask;
+	uint32_t pad = 0;
+
+	EFM_ASSERT(len <= SPSC_RECORD_MAX);
+	if(pos + spsc_ring_record_size(len) > ring->mask + 1){
+		pad = ring->mask + 1 - pos;
+	}
+	if(pad + spsc_ring_record_size(len) > spsc_ring_space(ring)) return NULL;
+	ring->pad = pad;
+	ring->reserved = len;
+	return &ring->buf[(pos + pad + SPSC_RECORD_HEADER) & ring->mask];
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Publishes the reserved record.  Called by the producer only.
+ *
+ * @param[in] len
+ *	The number of bytes actually written, at most the reserved length.
+ *
+ * @param[in] flags
+ *	Three user flag bits stored with the record.
+ ******************************************************************************/
+void spsc_ring_commit(SPSC_RING *ring, uint32_t len, uint32_t flags){
+	EFM_ASSERT(len <= ring->reserved);
+	EFM_ASSERT(flags <= (SPSC_RECORD_FLAGS >> SPSC_RECORD_FLAG_SHIFT));
+	if(ring->pad){
+		spsc_ring_set_header(ring, ring->head & ring->mask, SPSC_RECORD_PAD);
+	}
+	spsc_ring_set_header(ring, (ring->head + ring->pad) & ring->mask, len | (flags << SPSC_RECORD_FLAG_SHIFT));
+	spsc_ring_publish(ring, ring->pad + spsc_ring_record_size(len));
+	ring->pad = 0;
+	ring->reserved = 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Returns the oldest record without removing it.  Called by the consumer only.
+ *
+ * @details
+ *	The record stays valid, and is not overwritten by the producer, until
+ *	spsc_ring_consume_record() is called.
+ *
+ * @param[out] *len
+ *	The length of the record.
+ *
+ * @param[out] *flags
+ *	The user flag bits of the record, or NULL if they are not needed.
+ *
+ * @return
+ *	A pointer to the record inside the ring, or NULL if the ring is empty.
+ ******************************************************************************/
+void *spsc_ring_peek_record(SPSC_RING *ring, uint32_t *len, uint32_t *flags){
+	uint32_t offset = 0;
+
+	return spsc_ring_peek_next(ring, &offset, len, flags);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Walks the records in the ring without removing them.  Called by the consumer only.
+ *
+ * @details
+ *	Starting with offset 0, each call returns the next record and moves offset past it,
+ *	so the consumer can use several records in place before consuming them in order.
+ *
+ * @param[in,out] *offset
+ *	The number of bytes from the tail to start looking at.
+ *
+ * @param[out] *len
+ *	The length of the record.
+ *
+ * @param[out] *flags
+ *	The user flag bits of the record, or NULL if they are not needed.
+ *
+ * @return
+ *	A pointer to the record inside the ring, or NULL if there are no more records.
+ ******************************************************************************/
+void *spsc_ring_peek_next(SPSC_RING *ring, uint32_t *offset, uint32_t *len, uint32_t *flags){
+	uint32_t count = spsc_ring_count(ring);
+	uint32_t pos;
+	uint32_t header;
+
+	while(*offset + SPSC_RECORD_HEADER <= count){
+		pos = (ring->tail + *offset) & ring->mask;
+		header = spsc_ring_header(ring, pos);
+		if(header & SPSC_RECORD_PAD){
+			*offset += ring->mask + 1 - pos;
+			continue;
+		}
+		*len = header & SPSC_RECORD_LEN;
+		if(flags != NULL) *flags = (header & SPSC_RECORD_FLAGS) >> SPSC_RECORD_FLAG_SHIFT;
+		*offset += spsc_ring_record_size(*len);
+		EFM_ASSERT(*offset <= count);	// records are published whole
+		return &ring->buf[(pos + SPSC_RECORD_HEADER) & ring->mask];
+	}
+	return NULL;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Removes the oldest record, and the filler in front of it.  Called by the consumer only.
+ ******************************************************************************/
+void spsc_ring_consume_record(SPSC_RING *ring){
+	uint32_t pos;
+	uint32_t header;
+
+	EFM_ASSERT(spsc_ring_count(ring) >= SPSC_RECORD_HEADER);
+	pos = ring->tail & ring->mask;
+	header = spsc_ring_header(ring, pos);
+	if(header & SPSC_RECORD_PAD){
+		spsc_ring_release(ring, ring->mask + 1 - pos);
+		EFM_ASSERT(spsc_ring_count(ring) >= SPSC_RECORD_HEADER);	// filler is always followed by a record
+		header = spsc_ring_header(ring, 0);
+	}
+	spsc_ring_release(ring, spsc_ring_record_size(header & SPSC_RECORD_LEN));
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Copies a message into the ring as one record.  Called by the producer only.
+ *
+ * @return
+ *	false, with nothing written, if the record does not fit.
+ ******************************************************************************/
+bool spsc_ring_write_record(SPSC_RING *ring, const void *data, uint32_t len){
+	void *record = spsc_ring_reserve(ring, len);
+
+	if(record == NULL) return false;
+	memcpy(record, data, len);
+	spsc_ring_commit(ring, len, 0);
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Copies the oldest record out of the ring and removes it.  Called by the consumer only.
+ *
+ * @param[in] max
+ *	The size of data.  A record longer than max is truncated.
+ *
+ * @param[out] *len
+ *	The number of bytes copied to data.
+ *
+ * @return
+ *	false if the ring is empty.
+ ******************************************************************************/
+bool spsc_ring_read_record(SPSC_RING *ring, void *data, uint32_t max, uint32_t *len){
+	uint32_t record_len;
+	void *record = spsc_ring_peek_record(ring, &record_len, NULL);
+
+	if(record == NULL) return false;
+	*len = record_len < max ? record_len : max;
+	memcpy(data, record, *len);
+	spsc_ring_consume_record(ring);
+	return true;
+}
@@ -0,0 +1,242 @@
+/**
+ * @file stats.c
+ * @author Justin Thwaites
+ * @date 5/25/2020
+ * @brief Running min, max, mean and standard deviation over a window of samples
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include "stats.h"
+#include "format.h"
+
+//***********************************************************************************
+// private variables
+//***********************************************************************************
+static uint32_t count;
+static int32_t min;
+static int32_t max;
+static int32_t mean;		// STATS_FRAC_BITS fraction bits
+static int64_t sum;			// exact, for the reported mean
+static int64_t m2;			// sum of squared deviations, 2 * STATS_FRAC_BITS fraction bits
+static uint32_t window;
+static STATS_CB stats_cb;
+
+/***************************************************************************//**
+ * @brief Stats module
+ * @details
+ *  Each sample updates a running min, max, mean and sum of squared deviations
+ *  with Welford's algorithm, so nothing but the running values is stored and
+ *  the variance does not lose precision to the large sum of squares a naive
+ *  formula would need.  The running mean is kept with STATS_FRAC_BITS fraction
+ *  bits and the squared deviations in 64 bits.  The reported mean comes from an
+ *  exact sum, as the rounding of the running mean can add up over a window.  Once the window number of
+ *  samples has been added the summary is handed to the callback and the
+ *  window starts again.
+ *
+ ******************************************************************************/
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *	Integer square root rounded to nearest.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ ******************************************************************************/
+static uint32_t stats_sqrt(uint64_t value){
+	uint64_t root = 0;
+	uint64_t bit = (uint64_t)1 << 62;
+
+	while(bit > value){
+		bit >>= 2;
+	}
+	while(bit != 0){
+		if(value >= root + bit){
+			value -= root + bit;
+			root = (root >> 1) + bit;
+		}
+		else{
+			root >>= 1;
+		}
+		bit >>= 2;
+	}
+	if(value > root) root++;	// value is now the remainder, rounds up past root + 0.5
+	return root;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Hands the summary of the window to the callback and starts the next window.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ ******************************************************************************/
+static void stats_send(void){
+	STATS_SUMMARY summary;
+
+	stats_summary(&summary);
+	stats_reset();
+	stats_cb(&summary);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Command handler for the window length.
+ *
+ * @note
+ *	This function is private and is called through the command table.
+ ******************************************************************************/
+static CMD_STATUS stats_cmd_window(CMD_ARG *arg){
+	return stats_set_window(arg->value) ? CMD_OK : CMD_BAD_ARG;
+}
+
+static const CMD_ENTRY stats_command = {
+	STATS_WINDOW_MESSAGE, CMD_ARG_INT, 0, STATS_MAX_WINDOW, stats_cmd_window
+};
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *	Starts an empty window and registers the window command.
+ *
+ * @note
+ *	This function should only be called once in setup of the device, after command_open().
+ *
+ * @param[in] summary_cb
+ *	Called with the summary at the end of every window.
+ ******************************************************************************/
+void stats_open(STATS_CB summary_cb){
+	EFM_ASSERT(summary_cb != NULL);
+	stats_cb = summary_cb;
+	window = STATS_DEFAULT_WINDOW;
+	stats_reset();
+	command_register(&stats_command);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Adds a sample to the window and sends the summary if the window is complete.
+ *
+ * @param[in] value
+ *	The sample, at most 2^22 in magnitude so the scaled mean fits in 32 bits.
+ ******************************************************************************/
+void stats_add(int32_t value){
+	int32_t scaled = value * STATS_ONE;
+	int32_t delta;
+
+	if(count == 0 || value < min) min = value;
+	if(count == 0 || value > max) max = value;
+	count++;
+	sum += value;
+	delta = scaled - mean;
+	mean += format_round_div(delta, count);
+	m2 += (int64_t)delta * (scaled - mean);
+
+	if(window != 0 && count >= window){
+		stats_send();
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Computes the summary of the samples added since the window started.
+ *
+ * @param[out] *summary
+ *	Receives the summary.  The standard deviation uses count - 1, and is 0 for a single sample.
+ ******************************************************************************/
+void stats_summary(STATS_SUMMARY *summary){
+	summary->count = count;
+	summary->min = min;
+	summary->max = max;
+	summary->mean = 0;
+	if(count > 0){
+		summary->mean = (sum + (sum < 0 ? -(int64_t)count : (int64_t)count) / 2) / (int64_t)count;
+	}
+	summary->stddev = 0;
+	if(count > 1 && m2 > 0){
+		summary->stddev = format_round_div(stats_sqrt(m2 / (count - 1)), STATS_ONE);
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Empties the window.
+ ******************************************************************************/
+void stats_reset(void){
+	count = 0;
+	min = 0;
+	max = 0;
+	mean = 0;
+	sum = 0;
+	m2 = 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Sets the number of samples summarized at a time.
+ *
+ * @details
+ *	If the window already holds that many samples the summary is sent.
+ *
+ * @param[in] samples
+ *	0 to STATS_MAX_WINDOW, 0 stops the summaries.
+ *
+ * @return
+ *	false if the window is out of range.
+ ******************************************************************************/
+bool stats_set_window(uint32_t samples){
+	if(samples > STATS_MAX_WINDOW) return false;
+	window = samples;
+	if(window != 0 && count >= window){
+		stats_send();
+	}
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	This function tests the summaries against values computed with exact math.
+ *
+ * @details
+ *	Covers a mean that rounds up, negative samples, and the standard deviation of a single
+ *	sample.  The window is emptied afterwards.
+ *
+ * @note
+ *	This function is a test and should only be called once, before any sample is added.
+ ******************************************************************************/
+void stats_test(void){
+	static const int32_t warm[STATS_TEST_SAMPLES] = { 7250, 7260, 7245, 7300, 7255, 7250, 7240, 7270 };
+	static const int32_t cold[STATS_TEST_SAMPLES] = { -120, -80, -100, -90, -110, -95, -105, -100 };
+	STATS_SUMMARY summary;
+
+	stats_reset();
+	for(uint32_t i = 0; i < STATS_TEST_SAMPLES; i++){
+		stats_add(warm[i]);
+	}
+	stats_summary(&summary);
+	EFM_ASSERT(summary.count == 8 && summary.min == 7240 && summary.max == 7300);
+	EFM_ASSERT(summary.mean == 7259 && summary.stddev == 19);		// 7258.75, 19.04
+
+	stats_reset();
+	for(uint32_t i = 0; i < STATS_TEST_SAMPLES; i++){
+		stats_add(cold[i]);
+	}
+	stats_summary(&summary);
+	EFM_ASSERT(summary.min == -120 && summary.max == -80);
+	EFM_ASSERT(summary.mean == -100 && summary.stddev == 12);		// -100, 12.25
+
+	stats_reset();
+	stats_add(5);
+	stats_summary(&summary);
+	EFM_ASSERT(summary.count == 1 && summary.mean == 5 && summary.stddev == 0);
+	stats_reset();
+}
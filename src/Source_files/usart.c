@@ -0,0 +1,558 @@
+/**
+ * @file usart.c
+ * @author Justin Thwaites
+ * @date May 4, 2020
+ * @brief Contains all the functions of the USART peripheral used as a
+ *  high-throughput asynchronous UART
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+
+//** Standard Library includes
+#include <string.h>
+
+//** Silicon Labs include files
+#include "em_cmu.h"
+
+//** Developer/user include files
+#include "usart.h"
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+
+
+//***********************************************************************************
+// private variables
+//***********************************************************************************
+static uint32_t	rx_done_evt;
+static uint32_t	tx_done_evt;
+
+
+static USART_PAYLOAD payload;
+static SPSC_RING rx_queue;
+static uint8_t rx_queue_storage[USART_RX_QUEUE_SIZE];
+static bool raw_saved_delimited;		// reception mode restored when raw reception ends
+
+/***************************************************************************//**
+ * @brief USART driver
+ * @details
+ *  This module contains the functions to support the driver's state machine
+ *  to transmit a string of data across a USART configured for asynchronous
+ *  operation.  It mirrors the LEUART driver so the BLE module can exchange
+ *  the low energy LEUART for the USART when it needs baud rates above what
+ *  the LEUART can generate from the 32768 Hz LFXO.  The USART is clocked
+ *  from HFPERCLK, so while it is open the device can not go below EM1.
+ *
+ ******************************************************************************/
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ * This is a private function to handle if a txbl interrupt is received
+ *
+ * @details
+ * By using a switch statement the function checks to make sure the transmission is in the correct
+ * state and then it performs the correct actions for that state.
+ *
+ * @note
+ *	This private function should only be called from the TX interrupt handler of the USART
+ *******************************************************************************/
+static void usart_txbl(void){
+	switch(payload.state){
+		case USART_INITIALIZE:
+			EFM_ASSERT(false);
+			break;
+
+		case USART_SEND_DATA:
+			if(payload.index < payload.message_len){
+				payload.usart->TXDATA = payload.message[payload.index++];
+				while(payload.index >= payload.message_len && ++payload.segment < payload.segment_count){
+					payload.message = payload.segments[payload.segment].data;	// next message of the burst
+					payload.message_len = payload.segments[payload.segment].len;
+					payload.index = 0;
+				}
+				if(payload.index >= payload.message_len){
+					payload.state = USART_FINISH_WAIT;
+					USART_IntDisable(payload.usart, USART_IEN_TXBL);
+					USART_IntClear(payload.usart, USART_IFC_TXC);
+					USART_IntEnable(payload.usart, USART_IEN_TXC);
+				}
+			}
+			else{
+				EFM_ASSERT(false);
+			}
+			break;
+
+		case USART_FINISH_WAIT:
+			EFM_ASSERT(false);
+			break;
+
+		default:
+			EFM_ASSERT(false);
+			break;
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ * This is a private function to handle if a txc interrupt is received
+ *
+ * @details
+ * By using a switch statement the function checks to make sure the transmission is in the correct
+ * state and then it performs the correct actions for that state.
+ *
+ * @note
+ *	This function should only occur once per message transmission signaling the end of
+ *	the transmission, and scheduling the tx_done event.
+ *******************************************************************************/
+static void usart_txc(void){
+	switch(payload.state){
+		case USART_INITIALIZE:
+			EFM_ASSERT(false);
+			break;
+
+		case USART_SEND_DATA:
+			EFM_ASSERT(false);
+			break;
+
+		case USART_FINISH_WAIT:
+			USART_IntDisable(payload.usart, USART_IEN_TXC);
+			add_scheduled_event(tx_done_evt);
+			sleep_unblock_mode(USART_TX_EM);
+			payload.txbusy = false;
+			payload.state = USART_INITIALIZE;
+			break;
+
+		default:
+			EFM_ASSERT(false);
+			break;
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Queues a completed message for the main loop and schedules the rx done event.
+ *
+ * @details
+ *	A message that does not fit in the RX queue is counted and dropped.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ *******************************************************************************/
+static void usart_rx_queue(void){
+	if(!spsc_ring_write_record(&rx_queue, payload.rx_message, payload.rx_index)){
+		payload.rx_dropped++;
+	}
+	add_scheduled_event(rx_done_evt);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Matches a received byte against the watched patterns.
+ *
+ * @details
+ *	Works as leuart_rx_watch_match().  A completed pattern is queued as a message of its own,
+ *	and a message in progress is discarded since the pattern was received in front of it.
+ *
+ * @return
+ *	true if the byte completed a pattern and must not be received as data.
+ *
+ * @note
+ *	This function is a private helper function that only has local scope.
+ *******************************************************************************/
+static bool usart_rx_watch_match(char data){
+	for(int i = 0; i < payload.watch_count; i++){
+		const char *pattern = payload.watch[i];
+		uint32_t *match = &payload.watch_match[i];
+
+		if(data == pattern[*match]){
+			(*match)++;
+		}
+		else{
+			*match = (data == pattern[0]);
+		}
+		if(pattern[*match] == 0){
+			*match = 0;
+			if(!spsc_ring_write_record(&rx_queue, pattern, strlen(pattern))){
+				payload.rx_dropped++;
+			}
+			add_scheduled_event(rx_done_evt);
+			payload.rx_index = 0;
+			payload.rxbusy = false;
+			payload.rx_state = USART_RX_WAIT;
+			return true;
+		}
+	}
+	return false;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	This is a private function to handle a received byte.
+ *
+ * @details
+ *	The USART does not have the start frame and signal frame hardware of the LEUART,
+ *	so the framing is done in software.  Bytes are ignored until the start frame
+ *	character, and the message is completed when the signal frame character is seen.
+ *	The start and signal frame characters are not stored in rx_message.  In delimited mode every
+ *	byte is stored and USART_RX_DELIMITER completes the message.  Completed messages are
+ *	queued on the RX queue.  As on the LEUART, every byte is first matched against the watched
+ *	patterns, and in raw mode every byte is queued as a message of its own.
+ *
+ * @note
+ *	The scheduled rx_done_event is added when a complete message is received.
+ *******************************************************************************/
+static void usart_rxdatav(void){
+	char data = payload.usart->RXDATA;
+	if(usart_rx_watch_match(data)) return;
+	if(payload.rx_raw){
+		payload.rx_message[0] = data;
+		payload.rx_index = 1;
+		usart_rx_queue();
+		payload.rx_index = 0;
+		return;
+	}
+	if(payload.rx_delimited){
+		if(data == USART_RX_DELIMITER){
+			usart_rx_queue();
+			payload.rx_index = 0;
+		}
+		else if(payload.rx_index < USART_MSG_SIZE - 1){
+			payload.rx_message[payload.rx_index++] = data;
+		}
+		return;
+	}
+	switch(payload.rx_state){
+		case USART_RX_WAIT:
+			if(data == USART_RX_STARTFRAME){
+				payload.rx_index = 0;
+				payload.rxbusy = true;
+				payload.rx_state = USART_RX_RECEIVE;
+			}
+			break;
+
+		case USART_RX_RECEIVE:
+			if(data == USART_RX_SIGFRAME){
+				payload.rxbusy = false;
+				payload.rx_state = USART_RX_WAIT;
+				usart_rx_queue();
+			}
+			else if(payload.rx_index < USART_MSG_SIZE - 1){
+				payload.rx_message[payload.rx_index++] = data;
+			}
+			break;
+
+		default:
+			EFM_ASSERT(false);
+			break;
+	}
+}
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ * This function sets up the usart peripheral for asynchronous operation
+ *
+ * @details
+ * This function enables the clock for the USART, then sets up the init-struct and calls the
+ * USART_InitAsync for this struct. It then routes the USART and enables the receive interrupt.
+ * The receiver stays enabled while the USART is open, so the lowest energy mode is blocked until
+ * usart_close() is called.  Watched patterns and raw reception are cleared, so they are set again
+ * after every open.
+ *
+ * @note
+ * This function can be called again after usart_close() to re-open the peripheral.
+ *
+ *@param[in] *usart
+ * This is the pointer to the registers of the USART
+ *
+ *@param[in] *usart_settings
+ *	This struct holds all of the parameter information necessary for the operation of the USART.
+ *
+ * ******************************************************************************/
+void usart_open(USART_TypeDef *usart, USART_OPEN_STRUCT *usart_settings){
+	USART_InitAsync_TypeDef start_usart = USART_INITASYNC_DEFAULT;
+
+	if(usart == USART0){
+		CMU_ClockEnable(cmuClock_USART0, true);
+	}
+	else {
+		EFM_ASSERT(false);
+	}
+	EFM_ASSERT(!payload.open);
+
+	start_usart.baudrate = usart_settings->baudrate;
+	start_usart.databits = usart_settings->databits;
+	start_usart.enable = usartDisable;
+	start_usart.parity = usart_settings->parity;
+	start_usart.refFreq = usart_settings->ref_freq;
+	start_usart.stopbits = usart_settings->stopbits;
+
+	rx_done_evt = usart_settings->rx_done_evt;
+	tx_done_evt = usart_settings->tx_done_evt;
+
+	payload.usart = usart;
+	payload.txbusy = false;
+	payload.rxbusy = false;
+	payload.state = USART_INITIALIZE;
+	payload.rx_state = USART_RX_WAIT;
+	payload.rx_index = 0;
+	payload.rx_dropped = 0;
+	payload.rx_raw = false;
+	payload.watch_count = 0;
+	spsc_ring_init(&rx_queue, rx_queue_storage, USART_RX_QUEUE_SIZE);
+
+	USART_InitAsync(usart, &start_usart);
+
+	usart->ROUTELOC0 = usart_settings->rx_loc | usart_settings->tx_loc;
+	usart->ROUTEPEN = (usart_settings->rx_pin_en * USART_ROUTEPEN_RXPEN | usart_settings->tx_pin_en * USART_ROUTEPEN_TXPEN);
+
+	usart->CMD = USART_CMD_CLEARRX | USART_CMD_CLEARTX;
+	USART_Enable(usart, usart_settings->enable);
+	if(usart_settings->enable){
+		while((usart->STATUS & USART_STATUS_TXENS) != USART_STATUS_TXENS);
+		while((usart->STATUS & USART_STATUS_RXENS) != USART_STATUS_RXENS);
+	}
+
+	sleep_block_mode(USART_RX_EM);
+	USART_IntClear(usart, USART_IFC_TXC);
+	USART_IntEnable(usart, USART_IEN_RXDATAV);
+
+	if(usart == USART0){
+		NVIC_EnableIRQ(USART0_RX_IRQn);
+		NVIC_EnableIRQ(USART0_TX_IRQn);
+	}
+	payload.open = true;
+}
+
+/***************************************************************************//**
+ * @brief
+ * This function shuts the usart peripheral down so the device can return to the low energy modes
+ *
+ * @details
+ * The interrupts are disabled, the pins are released from the USART so another peripheral can
+ * drive them, the USART is disabled and the clock is turned off.
+ *
+ * @note
+ * This function should only be called while the USART is not transmitting.
+ *
+ *@param[in] *usart
+ * This is the pointer to the registers of the USART
+ *
+ * ******************************************************************************/
+void usart_close(USART_TypeDef *usart){
+	EFM_ASSERT(payload.open);
+	EFM_ASSERT(!payload.txbusy);
+	if(usart == USART0){
+		NVIC_DisableIRQ(USART0_RX_IRQn);
+		NVIC_DisableIRQ(USART0_TX_IRQn);
+	}
+	USART_IntDisable(usart, USART_IEN_RXDATAV | USART_IEN_TXBL | USART_IEN_TXC);
+	usart->ROUTEPEN = 0;
+	USART_Enable(usart, usartDisable);
+	if(usart == USART0){
+		CMU_ClockEnable(cmuClock_USART0, false);
+	}
+	sleep_unblock_mode(USART_RX_EM);
+	payload.open = false;
+}
+
+/*****************************************************************************
+ * @brief
+ * This is The RX interrupt handler for the USART0
+ *
+ * @details
+ * This function clears the flags and passes each received byte to the software framing.
+ *
+ *******************************************************************************/
+void USART0_RX_IRQHandler(void){
+	uint32_t int_flag;
+	int_flag = USART0->IF & USART0->IEN;
+	USART0->IFC = int_flag;
+	if(int_flag & USART_IF_RXDATAV){
+		usart_rxdatav();
+	}
+}
+
+/*****************************************************************************
+ * @brief
+ * This is The TX interrupt handler for the USART0
+ *
+ * @details
+ * This function checks if the interrupt was caused by the txbl interrupt or the txc interrupt
+ * and then calls the function of whichever of the two will handle the function properly.
+ *
+ *******************************************************************************/
+void USART0_TX_IRQHandler(void){
+	uint32_t int_flag;
+	int_flag = USART0->IF & USART0->IEN;
+	USART0->IFC = int_flag;
+	if(int_flag & USART_IF_TXBL){
+		usart_txbl();
+	}
+	if(int_flag & USART_IF_TXC){
+		usart_txc();
+	}
+}
+
+/*****************************************************************************
+ * @brief
+ * This function starts the software state machine for the usart transmission.
+ *
+ * @details
+ * This function keeps a pointer to the inputed character array, and then initializes the state machine and all other state
+ * information, then switches to the send state, and enables the TXBL interrupt.
+ *
+ * @note
+ *	This function should be called every time it is necessary to write a message over the USART.
+ *	The message is not copied, so the character array must not change until the tx done event.
+ *******************************************************************************/
+void usart_start(USART_TypeDef *usart, char *string, uint32_t string_len){
+	TX_SEGMENT segment;
+
+	segment.data = string;
+	segment.len = string_len;
+	usart_start_segments(usart, &segment, 1);
+}
+
+/*****************************************************************************
+ * @brief
+ * This function starts one transfer of several messages, sent back to back with a single tx done event.
+ *
+ * @note
+ *	Only the segment list is copied; the messages must not change until the tx done event.
+ *	The first segment must not be empty.
+ *******************************************************************************/
+void usart_start_segments(USART_TypeDef *usart, const TX_SEGMENT *segments, uint32_t count){
+	EFM_ASSERT(count > 0 && count <= TX_MAX_SEGMENTS);
+	sleep_block_mode(USART_TX_EM);
+	payload.state = USART_INITIALIZE;
+	payload.txbusy = true;
+	memcpy(payload.segments, segments, count * sizeof(TX_SEGMENT));
+	payload.segment_count = count;
+	payload.segment = 0;
+	payload.message_len = segments[0].len;
+	payload.message = segments[0].data;
+	payload.index = 0;
+	payload.usart = usart;
+	payload.state = USART_SEND_DATA;
+	USART_IntEnable(usart, USART_IEN_TXBL);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Returns the private variable that marks if the USART is in the middle of a transmission.
+ *
+ ******************************************************************************/
+bool usart_tx_busy(USART_TypeDef *usart){
+	return payload.txbusy;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Takes the oldest received message off the RX queue and NUL terminates it.
+ *
+ * @note
+ * 	This function is meant to allow outside functions to access private data.  It must only
+ * 	be called from the main loop.
+ *
+ *@param[out] *message
+ * A USART_MSG_SIZE array that receives the message.
+ *
+ *@return
+ * false if no message is waiting.
+ *
+ *******************************************************************************/
+bool usart_rx_read(char *message){
+	uint32_t len;
+
+	if(!spsc_ring_read_record(&rx_queue, message, USART_MSG_SIZE - 1, &len)) return false;
+	message[len] = 0;
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Switches the receiver between start/signal frame reception and delimited reception.
+ *
+ *@param[in] *usart
+ * This is the pointer to the registers of the USART
+ *
+ *@param[in] enable
+ * true for delimited (binary frame) reception, false for start/signal frame reception
+ *
+ *******************************************************************************/
+void usart_rx_delimited(USART_TypeDef *usart, bool enable){
+	__disable_irq();
+	payload.rx_index = 0;
+	payload.rxbusy = false;
+	payload.rx_state = USART_RX_WAIT;
+	payload.rx_delimited = enable;
+	__enable_irq();
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Adds a pattern that is matched in the received byte stream in every reception mode.
+ *
+ * @details
+ *	Used for the unframed notifications of the HM10, such as OK+CONN, the same as
+ *	leuart_rx_watch().  When the pattern has been received it is queued as a message and the rx
+ *	done event is scheduled.
+ *
+ * @note
+ *	The pattern must stay valid while the USART is open.
+ *
+ *@param[in] *usart
+ * This is the pointer to the registers of the USART
+ *
+ *@param[in] *pattern
+ * The NUL terminated pattern, at most USART_RX_WATCHES patterns may be added.
+ *
+ *******************************************************************************/
+void usart_rx_watch(USART_TypeDef *usart, const char *pattern){
+	EFM_ASSERT(payload.watch_count < USART_RX_WATCHES);
+	__disable_irq();
+	payload.watch[payload.watch_count] = pattern;
+	payload.watch_match[payload.watch_count] = 0;
+	payload.watch_count++;
+	__enable_irq();
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Switches the receiver to raw reception, where every byte is queued as it arrives.
+ *
+ * @details
+ *	Raw reception is used for the HM10 AT responses, which have neither start/signal frames
+ *	nor a delimiter.  Turning raw reception off restores the mode that was active before.
+ *
+ *@param[in] *usart
+ * This is the pointer to the registers of the USART
+ *
+ *@param[in] enable
+ * true for raw reception, false to restore the previous reception mode
+ *
+ *******************************************************************************/
+void usart_rx_raw(USART_TypeDef *usart, bool enable){
+	if(enable == payload.rx_raw) return;
+	if(enable){
+		raw_saved_delimited = payload.rx_delimited;
+		usart_rx_delimited(usart, false);
+		payload.rx_raw = true;
+	}
+	else{
+		payload.rx_raw = false;
+		usart_rx_delimited(usart, raw_saved_delimited);
+	}
+}
@@ -90,6 +90,9 @@ int main(void)
 	  if(get_scheduled_events() & LEUART0_RX_DONE_EVT){
 		  leuart0_rx_done_evt();
 	  }
+	  if(get_scheduled_events() & BLE_AT_DONE_EVT){
+		  scheduled_ble_at_done_evt();
+	  }
 
   }
 }
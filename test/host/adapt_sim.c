@@ -0,0 +1,155 @@
+/**
+ * @file adapt_sim.c
+ * @author Justin Thwaites
+ * @date 5/30/2020
+ * @brief Host simulation of the adaptive sample period against synthetic traces
+ *
+ * @details
+ *  Runs the adapt module over three synthetic 4 hour temperature traces, in hundredths
+ *  of a degree F, and compares it with fixed sampling:
+ *  - flat drift: a slow 0.3 F swing over 4 hours.
+ *  - door openings: four 5 F drops an hour apart, each recovering over minutes.
+ *  - heater ramp: a 12 F rise over 30 minutes that decays back.
+ *  Each reading gets +-1 hundredth of a degree of noise, and the reading is held until
+ *  the next one, as the app sees it.  Every SIM_STEP ms the held reading is compared with
+ *  the trace, and the sample count, RMS and max error are reported for each sampling.
+ *
+ *  No recorded traces are in the tree, so these numbers only show the trade between
+ *  samples and error, not the savings on a deployed unit.  adapt_test() runs first, with
+ *  the host em_assert.h turning a failed EFM_ASSERT into an abort.
+ *
+ *  Build and run from the top of the repository:
+ *	gcc -O2 -Itest/host -Isrc/Header_files test/host/adapt_sim.c src/Source_files/adapt.c src/Source_files/format.c -lm -o /tmp/adapt_sim
+ *	/tmp/adapt_sim
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "adapt.h"
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define SIM_DURATION		(4 * 3600 * 1000)	// ms
+#define SIM_STEP			100					// ms between error measurements
+#define SIM_FIXED_PERIOD	3100				// ms, the period the adaptive sampling must match in energy
+#define SIM_TRACES			3
+
+//***********************************************************************************
+// private variables
+//***********************************************************************************
+static const char *trace_names[SIM_TRACES] = { "flat drift", "door openings", "heater ramp" };
+static uint32_t current_period;
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *	Host stand-ins for the command table and the BLE reply, unused by the simulation.
+ ******************************************************************************/
+void command_register(const CMD_ENTRY *entry){
+}
+
+void ble_reply(char *reply){
+}
+
+/***************************************************************************//**
+ * @brief
+ *	The apply callback, the LETIMER period of the app.
+ ******************************************************************************/
+static bool sim_apply(uint32_t period, uint32_t slope){
+	current_period = period;
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Returns a trace at a time in ms, in hundredths of a degree F.
+ ******************************************************************************/
+static double sim_trace(int trace, double time){
+	double min = time / 60000.0;
+	double value;
+	double since;
+
+	if(trace == 0){
+		return 7200 + 30 * sin(2 * M_PI * min / 240);
+	}
+	if(trace == 1){
+		value = 7200;
+		for(int i = 0; i < 4; i++){
+			since = min - (30 + i * 60);
+			if(since <= 0) continue;
+			if(since < 5) value -= 500 * (1 - exp(-since / 1.5));
+			else value -= 500 * (1 - exp(-5 / 1.5)) * exp(-(since - 5) / 4.0);
+		}
+		return value;
+	}
+	value = 7200 + 20 * sin(2 * M_PI * min / 240);
+	if(min > 120 && min < 150) value += (min - 120) * 40;
+	if(min >= 150) value += 1200 * exp(-(min - 150) / 20.0);
+	return value;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Samples a trace at a fixed period, or through the adapt module with a period of 0, and
+ *	prints one row of the table.
+ ******************************************************************************/
+static void sim_run(int trace, uint32_t fixed){
+	bool adaptive = fixed == 0;
+	double held = sim_trace(trace, 0);
+	double error;
+	double square_sum = 0;
+	double max = 0;
+	uint32_t steps = 0;
+	uint32_t samples = 0;
+	uint32_t next = 0;
+	int32_t value;
+	char sampling[16];
+
+	srand(1);
+	current_period = adaptive ? SIM_FIXED_PERIOD : fixed;
+	adapt_open(sim_apply, current_period);
+	if(adaptive) adapt_set_enable(true);
+	for(uint32_t time = 0; time < SIM_DURATION; time += SIM_STEP){
+		if(time >= next){
+			value = lround(sim_trace(trace, time) + (rand() % 3 - 1));
+			held = value;
+			samples++;
+			if(adaptive) adapt_sample(time, value);
+			next = time + current_period;
+		}
+		error = fabs(sim_trace(trace, time) - held);
+		square_sum += error * error;
+		if(error > max) max = error;
+		steps++;
+	}
+	if(adaptive) snprintf(sampling, sizeof(sampling), "adaptive");
+	else snprintf(sampling, sizeof(sampling), "fixed %.1f s", fixed / 1000.0);
+	printf("| %-16s | %-12s | %7u | %4.1f | %5.1f |\n", trace_names[trace], sampling, samples,
+			sqrt(square_sum / steps), max);
+}
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+int main(void){
+	adapt_open(sim_apply, SIM_FIXED_PERIOD);
+	adapt_test();
+	printf("| Trace            | Sampling     | Samples | RMS  | Max   |\n");
+	printf("|------------------|--------------|---------|------|-------|\n");
+	for(int trace = 0; trace < SIM_TRACES; trace++){
+		sim_run(trace, SIM_FIXED_PERIOD);
+		sim_run(trace, SIM_FIXED_PERIOD * 2);
+		sim_run(trace, 0);
+	}
+	return 0;
+}
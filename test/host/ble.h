@@ -0,0 +1,13 @@
+/*
+ * ble.h
+ *
+ *  Host stand-in for the BLE module, for the host tests and benchmarks only.  The host
+ *  program defines ble_reply().
+ */
+
+#ifndef HOST_BLE_H
+#define	HOST_BLE_H
+
+void ble_reply(char *reply);
+
+#endif
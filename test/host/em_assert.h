@@ -0,0 +1,14 @@
+/*
+ * em_assert.h
+ *
+ *  Host stand-in for the emlib assert, for the host tests and benchmarks only.
+ */
+
+#ifndef HOST_EM_ASSERT_H
+#define	HOST_EM_ASSERT_H
+
+#include <assert.h>
+
+#define EFM_ASSERT(expr)	assert(expr)
+
+#endif
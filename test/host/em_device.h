@@ -0,0 +1,13 @@
+/*
+ * em_device.h
+ *
+ *  Host stand-in for the device header, for the host tests and benchmarks only.
+ *  The Cortex-M4 __DMB() becomes a full fence of the host compiler.
+ */
+
+#ifndef HOST_EM_DEVICE_H
+#define	HOST_EM_DEVICE_H
+
+#define __DMB()		__atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+#endif
@@ -0,0 +1,218 @@
+/**
+ * @file ring_bench.c
+ * @author Justin Thwaites
+ * @date 5/10/2020
+ * @brief Host microbenchmark of the BLE ring buffer push and pop
+ *
+ * @details
+ *  Pushes and pops the same BLE_BENCH_MSG_LEN byte message through three rings, in batches
+ *  of BENCH_BATCH so the cycle counter reads are spread over several messages, and
+ *  reports the throughput of each side in bytes per 1000 cycles, the unit of
+ *  ble_circ_benchmark() on the target:
+ *  - modulo: the original ring, a runtime size and a % on every byte.
+ *  - masked: free running indexes masked with a compile time power of two size.
+ *  - spsc: the spsc_ring records the BLE queue uses now, copied with memcpy.
+ *
+ *  Cycles are read from the time stamp counter on x86 and derived from the monotonic
+ *  clock elsewhere, so the numbers compare the rings with each other, not with the
+ *  Cortex-M4.
+ *
+ *  Build and run from the top of the repository:
+ *	gcc -O2 -Itest/host -Isrc/Header_files test/host/ring_bench.c src/Source_files/spsc_ring.c -o /tmp/ring_bench
+ *	/tmp/ring_bench
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "spsc_ring.h"
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define BENCH_CIRC_SIZE		512			// BLE_CIRC_SIZE
+#define BENCH_CIRC_MASK		(BENCH_CIRC_SIZE - 1)
+#define BENCH_MSG_LEN		32			// BLE_BENCH_MSG_LEN
+#define BENCH_ROUNDS		500000
+#define BENCH_BATCH			8			// messages pushed, then popped, between cycle counter reads
+#define BENCH_REPEATS		5			// the fastest run of each ring is reported
+
+typedef struct {
+	char		cbuf[BENCH_CIRC_SIZE];
+	uint32_t	size;
+	uint32_t	read_ptr;
+	uint32_t	write_ptr;
+} MODULO_RING;
+
+typedef struct {
+	char		cbuf[BENCH_CIRC_SIZE];
+	uint32_t	read_ptr;		// free running
+	uint32_t	write_ptr;		// free running
+} MASKED_RING;
+
+typedef struct {
+	uint64_t	push;
+	uint64_t	pop;
+} BENCH_RESULT;
+
+//***********************************************************************************
+// private variables
+//***********************************************************************************
+static volatile uint32_t runtime_size = BENCH_CIRC_SIZE;	// keeps the modulo from becoming a mask
+static MODULO_RING modulo_ring;
+static MASKED_RING masked_ring;
+static SPSC_RING spsc;
+static uint8_t spsc_storage[BENCH_CIRC_SIZE];
+static char msg[BENCH_MSG_LEN + 1];
+static char out[BENCH_CIRC_SIZE];
+static uint32_t checksum;
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *	Returns the cycle counter of the host.
+ ******************************************************************************/
+static uint64_t bench_cycles(void){
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000u + now.tv_nsec;
+#endif
+}
+
+/***************************************************************************//**
+ * @brief
+ *	The original ring: a length byte, then the string, every index reduced with %.
+ ******************************************************************************/
+static void modulo_push(char *string){
+	uint32_t packet_size = strlen(string) + 1;
+
+	modulo_ring.cbuf[modulo_ring.write_ptr] = packet_size;
+	for(uint32_t i = 1; i < packet_size; i++){
+		modulo_ring.cbuf[(modulo_ring.write_ptr + i) % modulo_ring.size] = string[i - 1];
+	}
+	modulo_ring.write_ptr = (modulo_ring.write_ptr + packet_size) % modulo_ring.size;
+}
+
+static uint32_t modulo_pop(char *string){
+	uint32_t string_length = modulo_ring.cbuf[modulo_ring.read_ptr] - 1;
+
+	for(uint32_t i = 0; i < string_length; i++){
+		string[i] = modulo_ring.cbuf[(modulo_ring.read_ptr + 1 + i) % modulo_ring.size];
+	}
+	modulo_ring.read_ptr = (modulo_ring.read_ptr + string_length + 1) % modulo_ring.size;
+	return string_length;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	The power of two ring: the same layout, free running indexes masked on access.
+ ******************************************************************************/
+static void masked_push(char *string){
+	uint32_t packet_size = strlen(string) + 1;
+
+	masked_ring.cbuf[masked_ring.write_ptr & BENCH_CIRC_MASK] = packet_size;
+	for(uint32_t i = 1; i < packet_size; i++){
+		masked_ring.cbuf[(masked_ring.write_ptr + i) & BENCH_CIRC_MASK] = string[i - 1];
+	}
+	masked_ring.write_ptr += packet_size;
+}
+
+static uint32_t masked_pop(char *string){
+	uint32_t string_length = masked_ring.cbuf[masked_ring.read_ptr & BENCH_CIRC_MASK] - 1;
+
+	for(uint32_t i = 0; i < string_length; i++){
+		string[i] = masked_ring.cbuf[(masked_ring.read_ptr + 1 + i) & BENCH_CIRC_MASK];
+	}
+	masked_ring.read_ptr += string_length + 1;
+	return string_length;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	The spsc_ring records, as ble_circ_push() and ble_circ_pop() use them.
+ ******************************************************************************/
+static void spsc_push(char *string){
+	spsc_ring_write_record(&spsc, string, strlen(string));
+}
+
+static uint32_t spsc_pop(char *string){
+	uint32_t len;
+
+	spsc_ring_read_record(&spsc, string, BENCH_CIRC_SIZE, &len);
+	return len;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Times BENCH_ROUNDS batches of pushes and pops of one ring, keeping the fastest of BENCH_REPEATS runs.
+ ******************************************************************************/
+static BENCH_RESULT bench_ring(void (*push)(char *), uint32_t (*pop)(char *)){
+	BENCH_RESULT best = { UINT64_MAX, UINT64_MAX };
+	uint64_t push_cycles;
+	uint64_t pop_cycles;
+	uint64_t start;
+
+	for(int repeat = 0; repeat < BENCH_REPEATS; repeat++){
+		push_cycles = 0;
+		pop_cycles = 0;
+		for(uint32_t i = 0; i < BENCH_ROUNDS; i++){
+			start = bench_cycles();
+			for(int j = 0; j < BENCH_BATCH; j++){
+				push(msg);
+			}
+			push_cycles += bench_cycles() - start;
+			start = bench_cycles();
+			for(int j = 0; j < BENCH_BATCH; j++){
+				checksum += pop(out);
+			}
+			pop_cycles += bench_cycles() - start;
+			checksum += out[i % BENCH_MSG_LEN];
+		}
+		if(push_cycles < best.push) best.push = push_cycles;
+		if(pop_cycles < best.pop) best.pop = pop_cycles;
+	}
+	return best;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Prints the throughput of one ring in bytes per 1000 cycles.
+ ******************************************************************************/
+static void bench_report(const char *name, BENCH_RESULT result){
+	uint64_t bytes = (uint64_t)BENCH_ROUNDS * BENCH_BATCH * BENCH_MSG_LEN;
+
+	printf("%-7s push %5llu B/kcyc  pop %5llu B/kcyc\n", name,
+			(unsigned long long)(bytes * 1000 / result.push),
+			(unsigned long long)(bytes * 1000 / result.pop));
+}
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+int main(void){
+	memset(msg, 'b', BENCH_MSG_LEN);
+	modulo_ring.size = runtime_size;
+	spsc_ring_init(&spsc, spsc_storage, BENCH_CIRC_SIZE);
+
+	bench_report("modulo", bench_ring(modulo_push, modulo_pop));
+	bench_report("masked", bench_ring(masked_push, masked_pop));
+	bench_report("spsc", bench_ring(spsc_push, spsc_pop));
+	printf("checksum %u\n", checksum);
+	return 0;
+}
@@ -0,0 +1,185 @@
+/**
+ * @file spsc_ring_stress.c
+ * @author Justin Thwaites
+ * @date 5/11/2020
+ * @brief Host stress test of the SPSC ring with a producer and a consumer thread
+ *
+ * @details
+ *  A producer thread writes numbered records of varying length into a STRESS_RING_SIZE
+ *  byte ring while a consumer thread reads them back, both yielding when the ring is full
+ *  or empty, so the test also runs on a single core.  Each record holds its sequence number and a fill byte derived from it, and
+ *  its length and flag bits are derived from it too, so the consumer catches a lost,
+ *  repeated, reordered, torn or truncated record.  Most records go through
+ *  spsc_ring_reserve()/spsc_ring_commit() and spsc_ring_peek_record()/
+ *  spsc_ring_consume_record(), the rest through the copying helpers, and the lengths make
+ *  records wrap the end of the storage behind filler.
+ *
+ *  The ring orders its indexes with SPSC_BARRIER(), which the host em_device.h maps to a
+ *  full fence.  The test exits with 1 at the first bad record.
+ *
+ *  Build and run from the top of the repository, with an optional record count that
+ *  defaults to 10^8:
+ *	gcc -O2 -pthread -Itest/host -Isrc/Header_files test/host/spsc_ring_stress.c src/Source_files/spsc_ring.c -o /tmp/spsc_ring_stress
+ *	/tmp/spsc_ring_stress
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "spsc_ring.h"
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define STRESS_RING_SIZE	256			// LEUART_RX_QUEUE_SIZE
+#define STRESS_RECORDS		100000000u
+#define STRESS_SEQ_SIZE		sizeof(uint32_t)
+#define STRESS_MAX_LEN		61			// odd lengths exercise the record alignment
+
+//***********************************************************************************
+// private variables
+//***********************************************************************************
+static SPSC_RING ring;
+static uint8_t storage[STRESS_RING_SIZE];
+static uint32_t records = STRESS_RECORDS;
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *	Returns the length, flag bits and fill byte of a record from its sequence number.
+ ******************************************************************************/
+static uint32_t stress_len(uint32_t seq){
+	return STRESS_SEQ_SIZE + (seq * 7 + seq / 3) % (STRESS_MAX_LEN - STRESS_SEQ_SIZE + 1);
+}
+
+static uint32_t stress_flags(uint32_t seq){
+	return seq % ((SPSC_RECORD_FLAGS >> SPSC_RECORD_FLAG_SHIFT) + 1);
+}
+
+static uint8_t stress_fill(uint32_t seq){
+	return (seq * 31) ^ (seq >> 8);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Returns if a record is built and read in place, which every record with flag bits is,
+ *	or copied with spsc_ring_write_record() and spsc_ring_read_record().
+ ******************************************************************************/
+static bool stress_in_place(uint32_t seq){
+	return (seq & 1) || stress_flags(seq) != 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Builds a record in buf and returns its length.
+ ******************************************************************************/
+static uint32_t stress_build(uint8_t *buf, uint32_t seq){
+	uint32_t len = stress_len(seq);
+
+	memcpy(buf, &seq, STRESS_SEQ_SIZE);
+	memset(buf + STRESS_SEQ_SIZE, stress_fill(seq), len - STRESS_SEQ_SIZE);
+	return len;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Checks a received record against the one expected, and exits on a mismatch.
+ ******************************************************************************/
+static void stress_check(const uint8_t *record, uint32_t len, uint32_t flags, uint32_t expected){
+	uint32_t seq;
+
+	memcpy(&seq, record, STRESS_SEQ_SIZE);
+	if(seq != expected){
+		printf("FAIL record %u: got sequence %u\n", expected, seq);
+		exit(1);
+	}
+	if(len != stress_len(seq) || flags != stress_flags(seq)){
+		printf("FAIL record %u: length %u flags %u\n", seq, len, flags);
+		exit(1);
+	}
+	for(uint32_t i = STRESS_SEQ_SIZE; i < len; i++){
+		if(record[i] != stress_fill(seq)){
+			printf("FAIL record %u: byte %u\n", seq, i);
+			exit(1);
+		}
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *	The producer thread.
+ ******************************************************************************/
+static void *stress_producer(void *arg){
+	uint8_t buf[STRESS_MAX_LEN];
+	uint8_t *record;
+	uint32_t len;
+
+	for(uint32_t seq = 0; seq < records; seq++){
+		len = stress_build(buf, seq);
+		if(stress_in_place(seq)){
+			while((record = spsc_ring_reserve(&ring, len)) == NULL) sched_yield();
+			memcpy(record, buf, len);
+			spsc_ring_commit(&ring, len, stress_flags(seq));
+		}
+		else{
+			while(!spsc_ring_write_record(&ring, buf, len)) sched_yield();
+		}
+	}
+	return NULL;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	The consumer thread.
+ ******************************************************************************/
+static void *stress_consumer(void *arg){
+	uint8_t buf[STRESS_MAX_LEN];
+	uint8_t *record;
+	uint32_t len;
+	uint32_t flags;
+
+	for(uint32_t seq = 0; seq < records; seq++){
+		if(stress_in_place(seq)){
+			while((record = spsc_ring_peek_record(&ring, &len, &flags)) == NULL) sched_yield();
+			stress_check(record, len, flags, seq);
+			spsc_ring_consume_record(&ring);
+		}
+		else{
+			while(!spsc_ring_read_record(&ring, buf, sizeof(buf), &len)) sched_yield();
+			stress_check(buf, len, 0, seq);
+		}
+	}
+	return NULL;
+}
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+int main(int argc, char **argv){
+	pthread_t producer;
+	pthread_t consumer;
+
+	if(argc > 1) records = strtoul(argv[1], NULL, 0);
+	spsc_ring_init(&ring, storage, STRESS_RING_SIZE);
+	pthread_create(&consumer, NULL, stress_consumer, NULL);
+	pthread_create(&producer, NULL, stress_producer, NULL);
+	pthread_join(producer, NULL);
+	pthread_join(consumer, NULL);
+	if(spsc_ring_count(&ring) != 0){
+		printf("FAIL %u bytes left in the ring\n", spsc_ring_count(&ring));
+		return 1;
+	}
+	printf("PASS %u records\n", records);
+	return 0;
+}